@@ -0,0 +1,180 @@
+// Hash table benchmark for the city / route tables.
+//
+// 1. Probing policies: fills an OpenAddressTable (CustomHash.h) with route
+//    keys ("C12-C3407") up to a fixed load factor, without growing, and
+//    times inserts, lookups of present keys (by string_view), lookups of
+//    absent keys and remove + insert churn for linear, quadratic and Robin
+//    Hood probing; then the same for ConcurrentTable (the city and route
+//    tables, "lf-") with linear and quadratic probing, from one thread.
+// 2. Concurrent lookups, as logins do them: 1 to 8 reader threads look up
+//    city names while one writer keeps updating cities, in ConcurrentTable
+//    (lock-free reads) and in an OpenAddressTable behind a shared_mutex.
+//
+// Build: make hash-bench        Run: ./HashBench.exe [slots]
+
+#include "../include/CustomHash.h"
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <shared_mutex>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+double nanosPer(Clock::time_point t0, Clock::time_point t1, size_t ops)
+{
+    return chrono::duration<double, nano>(t1 - t0).count() / ops;
+}
+
+// Lookup in either kind of table
+template <class Probe>
+bool get(const OpenAddressTable<string, int, StringHash, Probe> &table, string_view key, int &value)
+{
+    const int *found = table.find(key);
+    if (found)
+        value = *found;
+    return found;
+}
+
+template <class Probe>
+bool get(const ConcurrentTable<string, int, StringHash, Probe> &table, string_view key, int &value)
+{
+    return table.find(key, value);
+}
+
+template <class Table>
+void run(const char *name, int slots, double load, const vector<string> &keys, const vector<string> &absent)
+{
+    // Sized up front and allowed to fill up, so every policy sees the same load
+    Table table(slots, 0.99);
+    size_t n = slots * load;
+    long long sum = 0;
+    int value = 0;
+
+    auto t0 = Clock::now();
+    for (size_t i = 0; i < n; i++)
+        table.insert(keys[i], i);
+    auto t1 = Clock::now();
+    for (int round = 0; round < 4; round++)
+        for (size_t i = 0; i < n; i++)
+        {
+            get(table, string_view(keys[(i * 7919) % n]), value);
+            sum += value;
+        }
+    auto t2 = Clock::now();
+    for (int round = 0; round < 4; round++)
+        for (size_t i = 0; i < n; i++)
+            sum += get(table, string_view(absent[i]), value);
+    auto t3 = Clock::now();
+    for (size_t i = 0; i < n; i++)
+    {
+        table.erase(string_view(keys[i]));
+        table.insert(keys[i], i);
+    }
+    auto t4 = Clock::now();
+
+    cout << left << setw(14) << name << setw(7) << load << fixed << setprecision(1) << setw(12) << nanosPer(t0, t1, n)
+         << setw(12) << nanosPer(t1, t2, 4 * n) << setw(12) << nanosPer(t2, t3, 4 * n) << setw(12) << nanosPer(t3, t4, n)
+         << (sum == -1 ? "!" : "") << "\n";
+    cout.unsetf(ios::fixed);
+    cout << setprecision(6);
+}
+
+// Common interface of the two tables for the concurrent run
+struct LockFreeCities
+{
+    ConcurrentTable<string, int> table;
+    bool get(const string &key, int &value) const { return table.find(key, value); }
+    void put(const string &key, int value) { table.insert(key, value); }
+};
+
+struct LockedCities
+{
+    mutable shared_mutex lock;
+    OpenAddressTable<string, int> table;
+    bool get(const string &key, int &value) const
+    {
+        shared_lock<shared_mutex> guard(lock);
+        const int *found = table.find(key);
+        if (found)
+            value = *found;
+        return found;
+    }
+    void put(const string &key, int value)
+    {
+        unique_lock<shared_mutex> guard(lock);
+        table.insert(key, value);
+    }
+};
+
+// Million lookups per second, summed over the reader threads
+template <class Cities>
+double lookupRate(int readers, const vector<string> &names)
+{
+    Cities cities;
+    for (size_t i = 0; i < names.size(); i++)
+        cities.put(names[i], i);
+    const int perThread = 400000;
+    atomic<bool> stop{false};
+    thread writer([&]()
+                  {
+        for (size_t i = 0; !stop; i++)
+        {
+            cities.put(names[i % names.size()], i);
+            this_thread::yield();
+        } });
+    vector<thread> threads;
+    atomic<long long> found{0};
+    auto t0 = Clock::now();
+    for (int r = 0; r < readers; r++)
+        threads.emplace_back([&, r]()
+                             {
+            long long hits = 0;
+            int value;
+            for (int i = 0; i < perThread; i++)
+                hits += cities.get(names[(i * 31 + r) % names.size()], value);
+            found += hits; });
+    for (thread &t : threads)
+        t.join();
+    auto t1 = Clock::now();
+    stop = true;
+    writer.join();
+    return readers * perThread / chrono::duration<double, micro>(t1 - t0).count();
+}
+
+int main(int argc, char **argv)
+{
+    int slots = tableSizeFor(argc > 1 ? atoi(argv[1]) : 1 << 18);
+    mt19937 rng(7);
+    vector<string> keys(slots), absent(slots);
+    for (int i = 0; i < slots; i++)
+    {
+        keys[i] = "C" + to_string(rng() % 100000) + "-C" + to_string(i);
+        absent[i] = "C" + to_string(i) + "-X" + to_string(rng() % 100000);
+    }
+
+    cout << slots << " slots, ns per operation\n\n";
+    cout << left << setw(14) << "probe" << setw(7) << "load" << setw(12) << "insert" << setw(12) << "hit"
+         << setw(12) << "miss" << setw(12) << "churn" << "\n";
+    for (double load : {0.5, 0.75, 0.9})
+    {
+        run<OpenAddressTable<string, int, StringHash, LinearProbe>>("linear", slots, load, keys, absent);
+        run<OpenAddressTable<string, int, StringHash, QuadraticProbe>>("quadratic", slots, load, keys, absent);
+        run<OpenAddressTable<string, int, StringHash, RobinHoodProbe>>("robinhood", slots, load, keys, absent);
+        run<ConcurrentTable<string, int, StringHash, LinearProbe>>("lf-linear", slots, load, keys, absent);
+        run<ConcurrentTable<string, int, StringHash, QuadraticProbe>>("lf-quadratic", slots, load, keys, absent);
+    }
+
+    vector<string> names(4096);
+    for (size_t i = 0; i < names.size(); i++)
+        names[i] = "City" + to_string(i);
+    cout << "\nconcurrent lookups (" << names.size() << " cities, one writer), million lookups / s\n\n";
+    cout << left << setw(9) << "readers" << setw(12) << "lock-free" << "shared_mutex\n";
+    for (int readers : {1, 2, 4, 8})
+        cout << left << setw(9) << readers << fixed << setprecision(1) << setw(12)
+             << lookupRate<LockFreeCities>(readers, names) << lookupRate<LockedCities>(readers, names) << "\n";
+    return 0;
+}
@@ -0,0 +1,162 @@
+// Priority queue benchmark for the routing searches.
+//
+// Builds road-like grid networks whose road lengths are drawn from the
+// distances stored in routes.db (falls back to 20..400 if the file is missing),
+// then runs full shortest-path trees and point-to-point queries with every
+// queue policy from PriorityQueues.h.
+//
+// Build: make bench        Run: ./QueueBench.exe [routes.db]
+
+#include "../include/CustomGraph.h"
+#include <sqlite3.h>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+vector<int> loadDistances(const string &file)
+{
+    vector<int> dist;
+    sqlite3 *db = nullptr;
+    if (sqlite3_open_v2(file.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) == SQLITE_OK)
+    {
+        // Roads, or Routes in databases the server has not migrated yet
+        sqlite3_stmt *stmt;
+        for (const char *sql : {"SELECT Distance FROM Roads", "SELECT Distance FROM Routes"})
+            if (dist.empty() && sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK)
+            {
+                while (sqlite3_step(stmt) == SQLITE_ROW)
+                    dist.push_back(sqlite3_column_int(stmt, 0));
+                sqlite3_finalize(stmt);
+            }
+    }
+    sqlite3_close(db);
+    if (dist.empty())
+        for (int d = 20; d <= 400; d += 10)
+            dist.push_back(d);
+    return dist;
+}
+
+// side x side grid, ~10% of the roads missing so it is not perfectly regular
+CSRAdjacency makeGrid(int side, const vector<int> &lengths, unsigned seed)
+{
+    mt19937 rng(seed);
+    int n = side * side;
+    vector<vector<pair<int, int>>> adj(n);
+    auto road = [&](int a, int b)
+    {
+        int w = lengths[rng() % lengths.size()];
+        adj[a].push_back({b, w});
+        adj[b].push_back({a, w});
+    };
+    for (int r = 0; r < side; r++)
+        for (int c = 0; c < side; c++)
+        {
+            int u = r * side + c;
+            if (c + 1 < side && rng() % 10)
+                road(u, u + 1);
+            if (r + 1 < side && rng() % 10)
+                road(u, u + side);
+        }
+
+    CSRAdjacency g;
+    for (int u = 0; u < n; u++)
+    {
+        g.offset.push_back(g.target.size());
+        for (const auto &e : adj[u])
+        {
+            g.target.push_back(e.first);
+            g.weight.push_back(e.second);
+            g.blocked.push_back(0);
+            g.maxWeight = max(g.maxWeight, e.second);
+        }
+        g.finish.push_back(g.target.size());
+    }
+    g.limit = g.finish;
+    g.arcCount = g.target.size();
+    return g;
+}
+
+const char *queueName(QueueKind kind)
+{
+    switch (kind)
+    {
+    case QUEUE_BINARY:
+        return "binary";
+    case QUEUE_RADIX:
+        return "radix";
+    case QUEUE_DIAL:
+        return "dial";
+    default:
+        return "auto";
+    }
+}
+
+int main(int argc, char **argv)
+{
+    vector<int> lengths = loadDistances(argc > 1 ? argv[1] : "routes.db");
+    int maxLength = *max_element(lengths.begin(), lengths.end());
+    cout << "road lengths: " << lengths.size() << " samples, max " << maxLength
+         << ", auto picks " << queueName(chooseQueue(maxLength)) << "\n\n";
+
+    cout << left << setw(10) << "nodes" << setw(8) << "queue" << setw(14) << "tree ms"
+         << setw(14) << "p2p ms" << "speed-up (tree / p2p)\n";
+
+    for (int side : {32, 100, 200, 400})
+    {
+        CSRAdjacency g = makeGrid(side, lengths, 7);
+        int n = g.nodeCount();
+        int trees = max(3, 200000 / n), queries = max(20, 2000000 / n);
+
+        mt19937 rng(11);
+        vector<pair<int, int>> pairs(queries);
+        for (auto &p : pairs)
+            p = {(int)(rng() % n), (int)(rng() % n)};
+
+        double baseTree = 0, baseP2P = 0;
+        long long checksum = -1;
+        for (QueueKind kind : {QUEUE_BINARY, QUEUE_RADIX, QUEUE_DIAL})
+        {
+            vector<int> dist, parent;
+            long long sum = 0;
+            auto t0 = Clock::now();
+            for (int i = 0; i < trees; i++)
+                withQueue(kind, g.maxWeight, [&](auto &pq)
+                          { dijkstraAll(g, pairs[i].first, false, dist, parent, pq); });
+            auto t1 = Clock::now();
+
+            SearchSpace space;
+            auto zero = [](int)
+            { return 0; };
+            for (const auto &p : pairs)
+            {
+                int settled;
+                int d = withQueue(kind, g.maxWeight, [&](auto &pq)
+                                  { return searchPointToPoint(g, p.first, p.second, zero, space, settled, pq); });
+                sum += (d == INF ? -1 : d);
+                space.reset();
+            }
+            auto t2 = Clock::now();
+
+            // every queue must produce the same distances
+            if (checksum != -1 && checksum != sum)
+                cout << "  !! distance mismatch for " << queueName(kind) << "\n";
+            checksum = sum;
+
+            double treeMs = chrono::duration<double, milli>(t1 - t0).count() / trees;
+            double p2pMs = chrono::duration<double, milli>(t2 - t1).count() / queries;
+            if (kind == QUEUE_BINARY)
+            {
+                baseTree = treeMs;
+                baseP2P = p2pMs;
+            }
+            cout << left << setw(10) << n << setw(8) << queueName(kind) << setw(14) << fixed << setprecision(4) << treeMs
+                 << setw(14) << p2pMs << setprecision(2) << baseTree / treeMs << "x / " << baseP2P / p2pMs << "x\n";
+        }
+    }
+    return 0;
+}
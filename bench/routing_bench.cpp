@@ -0,0 +1,335 @@
+// Routing benchmark on generated networks.
+//
+// Generates three kinds of networks with 1k to 1M cities:
+//   grid       - road grid with ~10% of the roads missing (city streets)
+//   geometric  - random points, roads between points closer than a radius
+//                (about 6 roads per city, like a rural network)
+//   scalefree  - preferential attachment: every new city connects to two
+//                existing ones picked by degree, so a few hubs carry most
+//                roads (highway / airline-like)
+// with a share of the roads blocked, loads them into a Graph and measures
+//   shortest_path - Graph::getShortestPath between random cities
+//   next_hop      - GraphSnapshot::getNextHop towards a few hub cities, as a
+//                   shift asks it (the first query per hub builds its tree)
+//   shift         - whole shifts: getNextHops for every package on the
+//                   routing pool, packages moved, one road blocked or
+//                   reopened between shifts
+// and reports p50 / p99 latency and throughput per workload, as a table and
+// optionally as JSON for comparing builds.
+//
+// Build: make routing-bench
+// Run:   ./RoutingBench.exe [--sizes 1000,10000,100000,1000000]
+//                           [--topologies grid,geometric,scalefree]
+//                           [--blocked 0.02] [--budget 2] [--seed 7]
+//                           [--json results.json | --json -]
+
+#include "../include/CustomGraph.h"
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+struct Network
+{
+    vector<City> cities;
+    vector<RouteEntry> routes;
+};
+
+struct Options
+{
+    vector<int> sizes = {1000, 10000, 100000, 1000000};
+    vector<string> topologies = {"grid", "geometric", "scalefree"};
+    double blocked = 0.02; // share of blocked roads
+    double budget = 2.0;   // seconds per workload (at least a few operations run)
+    unsigned seed = 7;
+    string json;           // output file, "-" = stdout
+};
+
+struct Result
+{
+    string topology, workload;
+    int nodes, roads;
+    long long ops;
+    double p50, p99, mean; // microseconds per operation
+    double throughput;     // operations (shift: package moves) per second
+};
+
+string cityName(int i) { return "C" + to_string(i); }
+
+// Coordinates start at 1: (0, 0) means "no position" to Graph::load
+void addCity(Network &net, int i, double x, double y)
+{
+    net.cities.push_back({cityName(i), i + 1, "", (float)(x + 1), (float)(y + 1)});
+}
+
+void addRoad(Network &net, int a, int b, double length, mt19937 &rng, double blocked)
+{
+    bool isBlocked = uniform_real_distribution<double>(0, 1)(rng) < blocked;
+    net.routes.push_back({makeRouteKey(a + 1, b + 1), max(1, (int)lround(length)), isBlocked, OCCUPIED});
+}
+
+double distanceBetween(const City &a, const City &b)
+{
+    return hypot(a.x - b.x, a.y - b.y);
+}
+
+// Block length 100, roads up to 30% longer (detours)
+Network makeGrid(int n, double blocked, unsigned seed)
+{
+    mt19937 rng(seed);
+    uniform_real_distribution<double> detour(1.0, 1.3);
+    Network net;
+    int side = max(2, (int)lround(sqrt((double)n)));
+    for (int i = 0; i < side * side; i++)
+        addCity(net, i, (i % side) * 100.0, (i / side) * 100.0);
+    for (int r = 0; r < side; r++)
+        for (int c = 0; c < side; c++)
+        {
+            int u = r * side + c;
+            if (c + 1 < side && rng() % 10)
+                addRoad(net, u, u + 1, 100 * detour(rng), rng, blocked);
+            if (r + 1 < side && rng() % 10)
+                addRoad(net, u, u + side, 100 * detour(rng), rng, blocked);
+        }
+    return net;
+}
+
+// Points on a square of side 100 sqrt(n); the radius gives ~6 neighbours.
+// Points are bucketed by radius-sized cells so only 3x3 cells are compared.
+Network makeGeometric(int n, double blocked, unsigned seed)
+{
+    mt19937 rng(seed);
+    double side = 100.0 * sqrt((double)n);
+    double radius = 100.0 * sqrt(6.0 / acos(-1.0)); // pi r^2 = 6 cities
+    uniform_real_distribution<double> coord(0, side);
+    uniform_real_distribution<double> detour(1.0, 1.3);
+    Network net;
+    for (int i = 0; i < n; i++)
+        addCity(net, i, coord(rng), coord(rng));
+
+    int cells = max(1, (int)(side / radius));
+    auto cellOf = [&](double v)
+    { return min(cells - 1, (int)(v / side * cells)); };
+    vector<vector<int>> bucket(cells * cells);
+    for (int i = 0; i < n; i++)
+        bucket[cellOf(net.cities[i].y) * cells + cellOf(net.cities[i].x)].push_back(i);
+    for (int i = 0; i < n; i++)
+    {
+        const City &a = net.cities[i];
+        int cx = cellOf(a.x), cy = cellOf(a.y);
+        for (int y = max(0, cy - 1); y <= min(cells - 1, cy + 1); y++)
+            for (int x = max(0, cx - 1); x <= min(cells - 1, cx + 1); x++)
+                for (int j : bucket[y * cells + x])
+                {
+                    double d = distanceBetween(a, net.cities[j]);
+                    if (j > i && d <= radius)
+                        addRoad(net, i, j, d * detour(rng), rng, blocked);
+                }
+    }
+    return net;
+}
+
+// Barabasi-Albert with two roads per new city; 'ends' holds every road end,
+// so a uniform pick from it is a pick proportional to degree.
+Network makeScaleFree(int n, double blocked, unsigned seed)
+{
+    mt19937 rng(seed);
+    double side = 100.0 * sqrt((double)n);
+    uniform_real_distribution<double> coord(0, side);
+    Network net;
+    vector<int> ends;
+    for (int i = 0; i < n; i++)
+    {
+        addCity(net, i, coord(rng), coord(rng));
+        set<int> targets;
+        if (i == 1)
+            targets.insert(0);
+        while (i >= 2 && targets.size() < 2)
+            targets.insert(ends[rng() % ends.size()]);
+        for (int t : targets)
+        {
+            addRoad(net, t, i, distanceBetween(net.cities[t], net.cities[i]), rng, blocked);
+            ends.push_back(t);
+            ends.push_back(i);
+        }
+    }
+    return net;
+}
+
+Network makeNetwork(const string &topology, int n, double blocked, unsigned seed)
+{
+    if (topology == "grid")
+        return makeGrid(n, blocked, seed);
+    if (topology == "geometric")
+        return makeGeometric(n, blocked, seed);
+    return makeScaleFree(n, blocked, seed);
+}
+
+// Runs op() until the budget is used up (at least minOps times) and
+// summarizes the latencies; 'units' = work units per op for the throughput.
+template <typename Op>
+Result measure(const string &workload, double budget, long long minOps, long long units, Op op)
+{
+    vector<double> micros;
+    auto start = Clock::now();
+    double elapsed = 0;
+    while ((long long)micros.size() < minOps || elapsed < budget)
+    {
+        auto t0 = Clock::now();
+        op();
+        auto t1 = Clock::now();
+        micros.push_back(chrono::duration<double, micro>(t1 - t0).count());
+        elapsed = chrono::duration<double>(t1 - start).count();
+    }
+    Result r;
+    r.workload = workload;
+    r.ops = micros.size();
+    double total = 0;
+    for (double m : micros)
+        total += m;
+    sort(micros.begin(), micros.end());
+    r.p50 = micros[micros.size() / 2];
+    r.p99 = micros[min(micros.size() - 1, micros.size() * 99 / 100)];
+    r.mean = total / micros.size();
+    r.throughput = units * 1e6 / r.mean;
+    return r;
+}
+
+vector<Result> runNetwork(const string &topology, int n, const Options &opt)
+{
+    Network net = makeNetwork(topology, n, opt.blocked, opt.seed);
+    n = net.cities.size();
+    SimpleHash noCities(1);
+    hashroutes noRoutes;
+    Graph graph(noCities, noRoutes);
+    graph.load(net.cities, net.routes);
+
+    mt19937 rng(opt.seed + 1);
+    auto randomCity = [&]
+    { return cityName(rng() % n); };
+    // Destinations of the next-hop and shift workloads
+    vector<string> hubs;
+    for (int i = 0; i < min(32, n); i++)
+        hubs.push_back(randomCity());
+
+    vector<Result> results;
+    results.push_back(measure("shortest_path", opt.budget, 5, 1, [&]
+                              { graph.getShortestPath(randomCity(), randomCity()); }));
+
+    shared_ptr<const GraphSnapshot> snap = graph.pin();
+    results.push_back(measure("next_hop", opt.budget, 100, 1, [&]
+                              { snap->getNextHop(randomCity(), hubs[rng() % hubs.size()]); }));
+    snap.reset();
+
+    WorkStealingPool pool;
+    vector<pair<string, string>> packages(5000);
+    for (auto &p : packages)
+        p = {randomCity(), hubs[rng() % hubs.size()]};
+    results.push_back(measure("shift", opt.budget, 3, packages.size(), [&]
+                              {
+        const RouteEntry &road = net.routes[rng() % net.routes.size()];
+        graph.setEdgeBlocked(road.key, rng() % 2 == 0);
+        vector<string> hops = graph.pin()->getNextHops(packages, pool);
+        for (size_t i = 0; i < packages.size(); i++)
+        {
+            // Arrived or stuck packages are replaced by new ones
+            if (hops[i].empty() || hops[i] == packages[i].second)
+                packages[i] = {randomCity(), hubs[rng() % hubs.size()]};
+            else
+                packages[i].first = hops[i];
+        } }));
+
+    for (Result &r : results)
+    {
+        r.topology = topology;
+        r.nodes = n;
+        r.roads = net.routes.size();
+    }
+    return results;
+}
+
+vector<string> splitList(const string &s)
+{
+    vector<string> out;
+    stringstream ss(s);
+    string item;
+    while (getline(ss, item, ','))
+        if (!item.empty())
+            out.push_back(item);
+    return out;
+}
+
+void writeJson(ostream &out, const Options &opt, const vector<Result> &results)
+{
+    out << "{\n  \"benchmark\": \"routing\",\n  \"blocked_ratio\": " << opt.blocked
+        << ",\n  \"seed\": " << opt.seed << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result &r = results[i];
+        out << "    {\"topology\": \"" << r.topology << "\", \"nodes\": " << r.nodes << ", \"roads\": " << r.roads
+            << ", \"workload\": \"" << r.workload << "\", \"ops\": " << r.ops << fixed << setprecision(3)
+            << ", \"p50_us\": " << r.p50 << ", \"p99_us\": " << r.p99 << ", \"mean_us\": " << r.mean
+            << ", \"throughput_per_s\": " << r.throughput << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        string flag = argv[i], value = argv[i + 1];
+        if (flag == "--sizes")
+        {
+            opt.sizes.clear();
+            for (const string &s : splitList(value))
+                opt.sizes.push_back(stoi(s));
+        }
+        else if (flag == "--topologies")
+            opt.topologies = splitList(value);
+        else if (flag == "--blocked")
+            opt.blocked = stod(value);
+        else if (flag == "--budget")
+            opt.budget = stod(value);
+        else if (flag == "--seed")
+            opt.seed = stoul(value);
+        else if (flag == "--json")
+            opt.json = value;
+        else
+        {
+            cerr << "unknown option " << flag << "\n";
+            return 1;
+        }
+    }
+
+    // The table goes to stderr when the JSON goes to stdout
+    ostream &table = opt.json == "-" ? cerr : cout;
+    table << left << setw(11) << "topology" << setw(9) << "nodes" << setw(9) << "roads" << setw(15) << "workload"
+          << setw(9) << "ops" << setw(12) << "p50 us" << setw(12) << "p99 us" << "throughput/s\n";
+    vector<Result> results;
+    for (const string &topology : opt.topologies)
+        for (int n : opt.sizes)
+            for (const Result &r : runNetwork(topology, n, opt))
+            {
+                table << left << setw(11) << r.topology << setw(9) << r.nodes << setw(9) << r.roads << setw(15)
+                      << r.workload << setw(9) << r.ops << fixed << setprecision(1) << setw(12) << r.p50 << setw(12)
+                      << r.p99 << setprecision(0) << r.throughput << "\n";
+                results.push_back(r);
+            }
+
+    if (opt.json == "-")
+        writeJson(cout, opt, results);
+    else if (!opt.json.empty())
+    {
+        ofstream file(opt.json);
+        writeJson(file, opt, results);
+    }
+    return 0;
+}
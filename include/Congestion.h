@@ -0,0 +1,70 @@
+#ifndef CONGESTION_H
+#define CONGESTION_H
+
+#include <vector>
+#include <cmath>
+
+using namespace std;
+
+// Load-dependent road costs. A road may have a capacity: the number of
+// packages it carries per shift in each direction. While a shift is routed,
+// every package that is sent over a road adds one to its load, and the next
+// package sees the road at the BPR (Bureau of Public Roads) cost
+//
+//     weight * (1 + ALPHA * (volume / capacity)^BETA)
+//
+// where volume includes the package itself. Roads without a capacity always
+// cost their weight, so a network without capacities routes as before.
+
+const double BPR_ALPHA = 0.15;
+const int BPR_BETA = 4;
+
+inline double congestedCost(int weight, int volume, int capacity)
+{
+    if (capacity <= 0)
+        return weight;
+    double ratio = (double)volume / capacity;
+    return weight * (1.0 + BPR_ALPHA * pow(ratio, BPR_BETA));
+}
+
+// Capacities of one graph version, attached to the edges they apply to as
+// (edge position, capacity) per node, like TimeTable.
+struct CapacityTable
+{
+    vector<vector<pair<int, int>>> byNode;
+
+    bool empty() const { return byNode.empty(); }
+};
+
+// Packages sent over every edge during one shift, by CSR slot, with the
+// capacities resolved to slots up front, so the routing loop only indexes
+// two arrays. Valid for the adjacency it was made from.
+class RoadLoads
+{
+private:
+    vector<int> load;
+    vector<int> capacity;
+
+public:
+    // Time complexity O(E + capped roads)
+    template <typename Adjacency>
+    RoadLoads(const Adjacency &g, const CapacityTable &table)
+        : load(g.target.size(), 0), capacity(g.target.size(), 0)
+    {
+        for (int u = 0; u < (int)table.byNode.size() && u < g.nodeCount(); u++)
+            for (const auto &entry : table.byNode[u])
+                capacity[g.begin(u) + entry.first] = entry.second;
+    }
+
+    // Cost of sending one more package over edge 'slot'. O(1)
+    template <typename Adjacency>
+    double cost(const Adjacency &g, int slot) const
+    {
+        return congestedCost(g.weight[slot], load[slot] + 1, capacity[slot]);
+    }
+
+    void add(int slot) { load[slot]++; }
+    int volume(int slot) const { return load[slot]; }
+};
+
+#endif
@@ -0,0 +1,336 @@
+#ifndef CONTRACTION_HIERARCHY_H
+#define CONTRACTION_HIERARCHY_H
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <queue>
+#include <memory>
+
+using namespace std;
+
+// Customizable Contraction Hierarchy (CCH) over an undirected road network.
+//
+// build()     - metric independent: orders the nodes (minimum degree elimination),
+//               adds the fill-in shortcuts and records every lower triangle.
+//               Only depends on the topology, so it is redone only when roads
+//               or cities are added.
+// customize() - applies the current weights / blocked flags to all arcs by one
+//               linear pass over the triangles. This is what runs after a road
+//               is blocked or re-weighted.
+// query()     - bidirectional Dijkstra that only goes "upwards" in the order,
+//               then unpacks the shortcuts back into the original nodes.
+//
+// The adjacency type is any CSR-like structure with begin(u)/end(u) and
+// target/weight/blocked arrays indexed by arc (see CSRAdjacency).
+//
+// The metric independent part is shared between copies, so copying a
+// hierarchy and re-customizing the copy only duplicates the arc weights.
+class ContractionHierarchy
+{
+private:
+    static constexpr int UNREACHABLE = numeric_limits<int>::max();
+
+    struct Triangle
+    {
+        int lowerA; // arc bottom -> a
+        int lowerB; // arc bottom -> b
+        int upper;  // arc a -> b
+        int bottom; // node contracted to create the shortcut
+    };
+
+    struct Structure
+    {
+        int n = 0;
+        vector<int> rank; // node -> position in the contraction order
+
+        // Upward arcs in CSR form: arcs of node u go to higher ranked nodes and
+        // are sorted by head so an arc can be found by binary search.
+        vector<int> upOffset;
+        vector<int> upHead;
+        vector<Triangle> triangles; // in contraction order of their bottom node
+    };
+
+    shared_ptr<const Structure> topo; // null until build()
+    vector<int> upWeight;             // customized metric
+    vector<int> upMiddle;             // contracted node of a shortcut, -1 for an original road
+
+    struct QueryScratch
+    {
+        vector<int> distF, distB, parentF, parentB;
+        vector<int> touched;
+    };
+
+    static int findArc(const Structure &st, int lower, int higher)
+    {
+        auto first = st.upHead.begin() + st.upOffset[lower];
+        auto last = st.upHead.begin() + st.upOffset[lower + 1];
+        auto it = lower_bound(first, last, higher);
+        if (it == last || *it != higher)
+            return -1;
+        return (int)(it - st.upHead.begin());
+    }
+
+    int arcBetween(int a, int b) const
+    {
+        return topo->rank[a] < topo->rank[b] ? findArc(*topo, a, b) : findArc(*topo, b, a);
+    }
+
+    // Appends the original nodes between a and b (b included, a excluded).
+    void unpack(int a, int b, vector<int> &out) const
+    {
+        int middle = upMiddle[arcBetween(a, b)];
+        if (middle == -1)
+        {
+            out.push_back(b);
+            return;
+        }
+        unpack(a, middle, out);
+        unpack(middle, b, out);
+    }
+
+public:
+    bool isBuilt() const { return topo != nullptr; }
+    size_t shortcutCount() const { return topo ? topo->upHead.size() : 0; }
+
+    // True if a road u-v is already an arc (road or shortcut) of the hierarchy,
+    // so adding it only needs a customize() instead of a new build().
+    bool hasArc(int u, int v) const
+    {
+        if (!topo || u >= topo->n || v >= topo->n)
+            return false;
+        return u == v || arcBetween(u, v) != -1;
+    }
+
+    // Nodes from the last contracted to the first. Nodes that are contracted
+    // late sit on many shortest paths, which also makes this a good hub order
+    // for HubLabels. Empty until build().
+    vector<int> importanceOrder() const
+    {
+        vector<int> order;
+        if (!topo)
+            return order;
+        order.resize(topo->n);
+        for (int u = 0; u < topo->n; u++)
+            order[topo->n - 1 - topo->rank[u]] = u;
+        return order;
+    }
+
+    // Metric independent preprocessing.
+    // Time complexity O(sum over v of deg(v)^2) with deg taken at elimination time
+    template <typename Adjacency>
+    void build(const Adjacency &g)
+    {
+        auto st = make_shared<Structure>();
+        int n = st->n = g.nodeCount();
+        vector<int> &rank = st->rank;
+        rank.assign(n, -1);
+
+        // Working copy of the topology (blocked roads included, they only
+        // change the metric) as sorted neighbour lists without duplicates.
+        vector<vector<int>> adj(n);
+        for (int u = 0; u < n; u++)
+        {
+            for (int e = g.begin(u); e < g.end(u); e++)
+                if (g.target[e] != u)
+                    adj[u].push_back(g.target[e]);
+            sort(adj[u].begin(), adj[u].end());
+            adj[u].erase(unique(adj[u].begin(), adj[u].end()), adj[u].end());
+        }
+
+        // Minimum degree elimination with a lazy priority queue.
+        vector<vector<int>> upward(n);
+        priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq;
+        for (int u = 0; u < n; u++)
+            pq.push({(int)adj[u].size(), u});
+
+        int next = 0;
+        while (!pq.empty())
+        {
+            int deg = pq.top().first;
+            int v = pq.top().second;
+            pq.pop();
+            if (rank[v] != -1 || deg != (int)adj[v].size())
+                continue;
+            rank[v] = next++;
+            upward[v] = adj[v];
+
+            // Remove v and connect all of its remaining neighbours (fill-in).
+            for (int a : adj[v])
+            {
+                vector<int> merged;
+                merged.reserve(adj[a].size() + adj[v].size());
+                set_union(adj[a].begin(), adj[a].end(), adj[v].begin(), adj[v].end(), back_inserter(merged));
+                merged.erase(remove_if(merged.begin(), merged.end(), [&](int x)
+                                       { return x == v || x == a; }),
+                             merged.end());
+                adj[a].swap(merged);
+                pq.push({(int)adj[a].size(), a});
+            }
+            adj[v].clear();
+        }
+
+        vector<int> &upOffset = st->upOffset;
+        vector<int> &upHead = st->upHead;
+        upOffset.assign(n + 1, 0);
+        for (int u = 0; u < n; u++)
+            upOffset[u + 1] = upOffset[u] + (int)upward[u].size();
+        upHead.reserve(upOffset[n]);
+        for (int u = 0; u < n; u++)
+            upHead.insert(upHead.end(), upward[u].begin(), upward[u].end());
+
+        // Lower triangles: for every pair of upward neighbours a, b of v the
+        // shortcut a-b can be relaxed through v.
+        vector<int> order(n);
+        for (int u = 0; u < n; u++)
+            order[rank[u]] = u;
+        for (int v : order)
+        {
+            for (int i = upOffset[v]; i < upOffset[v + 1]; i++)
+                for (int j = i + 1; j < upOffset[v + 1]; j++)
+                {
+                    int a = upHead[i], b = upHead[j];
+                    if (rank[a] < rank[b])
+                        st->triangles.push_back({i, j, findArc(*st, a, b), v});
+                    else
+                        st->triangles.push_back({j, i, findArc(*st, b, a), v});
+                }
+        }
+
+        upWeight.assign(upHead.size(), UNREACHABLE);
+        upMiddle.assign(upHead.size(), -1);
+        topo = st;
+    }
+
+    // Applies the current weights and blocked flags.
+    // Time complexity O(E + T), T = number of triangles
+    template <typename Adjacency>
+    void customize(const Adjacency &g)
+    {
+        if (!topo)
+            return;
+        fill(upWeight.begin(), upWeight.end(), UNREACHABLE);
+        fill(upMiddle.begin(), upMiddle.end(), -1);
+
+        for (int u = 0; u < topo->n; u++)
+            for (int e = g.begin(u); e < g.end(u); e++)
+            {
+                int v = g.target[e];
+                if (g.blocked[e] || v == u || topo->rank[u] > topo->rank[v])
+                    continue;
+                int arc = findArc(*topo, u, v);
+                upWeight[arc] = min(upWeight[arc], g.weight[e]);
+            }
+
+        // Bottom-up: when a triangle is processed both lower arcs are final.
+        for (const auto &t : topo->triangles)
+        {
+            int wa = upWeight[t.lowerA], wb = upWeight[t.lowerB];
+            if (wa == UNREACHABLE || wb == UNREACHABLE)
+                continue;
+            if (wa + wb < upWeight[t.upper])
+            {
+                upWeight[t.upper] = wa + wb;
+                upMiddle[t.upper] = t.bottom;
+            }
+        }
+    }
+
+    // Shortest path between two dense node indices.
+    // Returns {-1, {}} if t cannot be reached, otherwise the distance and the
+    // full node sequence from s to t. Nodes added after build() have no roads
+    // and are unreachable.
+    pair<int, vector<int>> query(int s, int t) const
+    {
+        if (s == t)
+            return {0, {s}};
+        if (!topo || s < 0 || t < 0 || s >= topo->n || t >= topo->n)
+            return {-1, {}};
+        const int n = topo->n;
+        const vector<int> &upOffset = topo->upOffset;
+        const vector<int> &upHead = topo->upHead;
+
+        thread_local QueryScratch sc;
+        if ((int)sc.distF.size() != n)
+        {
+            sc.distF.assign(n, UNREACHABLE);
+            sc.distB.assign(n, UNREACHABLE);
+            sc.parentF.assign(n, -1);
+            sc.parentB.assign(n, -1);
+        }
+
+        typedef priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> MinQueue;
+        MinQueue pqF, pqB;
+        sc.distF[s] = 0;
+        sc.distB[t] = 0;
+        sc.touched.push_back(s);
+        sc.touched.push_back(t);
+        pqF.push({0, s});
+        pqB.push({0, t});
+
+        int best = UNREACHABLE, meet = -1;
+        auto step = [&](MinQueue &pq, vector<int> &dist, vector<int> &parent, const vector<int> &other)
+        {
+            int d = pq.top().first;
+            int u = pq.top().second;
+            pq.pop();
+            if (d > dist[u])
+                return;
+            if (other[u] != UNREACHABLE && d + other[u] < best)
+            {
+                best = d + other[u];
+                meet = u;
+            }
+            for (int a = upOffset[u]; a < upOffset[u + 1]; a++)
+            {
+                if (upWeight[a] == UNREACHABLE)
+                    continue;
+                int v = upHead[a];
+                if (d + upWeight[a] < dist[v])
+                {
+                    if (dist[v] == UNREACHABLE && sc.distF[v] == UNREACHABLE && sc.distB[v] == UNREACHABLE)
+                        sc.touched.push_back(v);
+                    dist[v] = d + upWeight[a];
+                    parent[v] = u;
+                    pq.push({dist[v], v});
+                }
+            }
+        };
+
+        // Each side stops once its smallest key cannot beat the best meeting point.
+        while ((!pqF.empty() && pqF.top().first < best) || (!pqB.empty() && pqB.top().first < best))
+        {
+            if (!pqF.empty() && pqF.top().first < best)
+                step(pqF, sc.distF, sc.parentF, sc.distB);
+            if (!pqB.empty() && pqB.top().first < best)
+                step(pqB, sc.distB, sc.parentB, sc.distF);
+        }
+
+        pair<int, vector<int>> result = {-1, {}};
+        if (meet != -1)
+        {
+            // Upward node chain s .. meet .. t, then every arc is unpacked.
+            vector<int> chain;
+            for (int v = meet; v != -1; v = sc.parentF[v])
+                chain.push_back(v);
+            reverse(chain.begin(), chain.end());
+            for (int v = sc.parentB[meet]; v != -1; v = sc.parentB[v])
+                chain.push_back(v);
+
+            result.first = best;
+            result.second.push_back(s);
+            for (size_t i = 0; i + 1 < chain.size(); i++)
+                unpack(chain[i], chain[i + 1], result.second);
+        }
+
+        for (int v : sc.touched)
+        {
+            sc.distF[v] = sc.distB[v] = UNREACHABLE;
+            sc.parentF[v] = sc.parentB[v] = -1;
+        }
+        sc.touched.clear();
+        return result;
+    }
+};
+
+#endif
@@ -2,12 +2,30 @@
 #define GRAPH_H
 
 #include "CustomHash.h"
+#include "ContractionHierarchy.h"
+#include "KShortestPaths.h"
+#include "TimeDependent.h"
+#include "Congestion.h"
+#include "HubLabels.h"
+#include "PriorityQueues.h"
+#include "ThreadPool.h"
+#include "QuadTree.h"
+#include "KdTree.h"
+#include "MinCostFlow.h"
 #include <vector>
 #include <map>
 #include <string>
 #include <limits>
 #include <algorithm>
 #include <queue>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+#include <set>
+#include <cmath>
 
 using namespace std;
 
@@ -28,26 +46,2073 @@ struct Edge
     bool isBlocked;
 };
 
+// Adjacency in compressed sparse row (CSR) form, indexed by the dense node
+// index (position in GraphSnapshot::nodes). The edges leaving node u occupy
+// [offset[u], finish[u]) of the target/weight/blocked arrays, so a
+// relaxation loop walks contiguous memory instead of chasing map nodes.
+// Slots [finish[u], limit[u]) are reserved for roads added to u later; when
+// they run out u's edges move to the end of the arrays (see Graph::addEdge),
+// so nodes are not necessarily stored in order.
+struct CSRAdjacency
+{
+    vector<int> offset; // first slot of every node
+    vector<int> finish; // one past the last edge of every node
+    vector<int> limit;  // end of the slots reserved for every node
+    vector<int> target; // dense index of the neighbour
+    vector<int> weight;
+    vector<char> blocked;
+    int arcCount = 0;  // live edges (the arrays may also hold unused slots)
+    int maxWeight = 0; // upper bound on every weight, used to pick the queue
+
+    int begin(int u) const { return offset[u]; }
+    int end(int u) const { return finish[u]; }
+    int degree(int u) const { return finish[u] - offset[u]; }
+    int nodeCount() const { return (int)finish.size(); }
+
+    void clear()
+    {
+        offset.clear();
+        finish.clear();
+        limit.clear();
+        target.clear();
+        weight.clear();
+        blocked.clear();
+        arcCount = 0;
+        maxWeight = 0;
+    }
+
+    // Gives every node exactly deg(u) slots, in node order. The order of the
+    // edges of one node is kept, so positions within a node stay valid.
+    // Time complexity O(V + E)
+    void compact()
+    {
+        CSRAdjacency packed;
+        packed.maxWeight = maxWeight;
+        packed.arcCount = arcCount;
+        packed.target.reserve(arcCount);
+        packed.weight.reserve(arcCount);
+        packed.blocked.reserve(arcCount);
+        for (int u = 0; u < nodeCount(); u++)
+        {
+            packed.offset.push_back(packed.target.size());
+            packed.target.insert(packed.target.end(), target.begin() + offset[u], target.begin() + finish[u]);
+            packed.weight.insert(packed.weight.end(), weight.begin() + offset[u], weight.begin() + finish[u]);
+            packed.blocked.insert(packed.blocked.end(), blocked.begin() + offset[u], blocked.begin() + finish[u]);
+            packed.finish.push_back(packed.target.size());
+        }
+        packed.limit = packed.finish;
+        *this = move(packed);
+    }
+};
+
+// Read-only view over a CSRAdjacency that looks like the old map<int, vector<Edge>>:
+// iterating it yields {nodeId, edges} pairs and every edge carries node ids, so
+// callers such as /api/map keep working unchanged.
+class AdjacencyView
+{
+private:
+    const CSRAdjacency &csr;
+    const vector<Node> &nodes;
+
+public:
+    class EdgeRange
+    {
+    private:
+        const AdjacencyView *view;
+        int first, last;
+
+    public:
+        class iterator
+        {
+        private:
+            const AdjacencyView *view;
+            int pos;
+
+        public:
+            iterator(const AdjacencyView *v, int p) : view(v), pos(p) {}
+            Edge operator*() const
+            {
+                return {view->nodes[view->csr.target[pos]].id, view->csr.weight[pos], view->csr.blocked[pos] != 0};
+            }
+            iterator &operator++()
+            {
+                pos++;
+                return *this;
+            }
+            bool operator!=(const iterator &o) const { return pos != o.pos; }
+        };
+
+        EdgeRange(const AdjacencyView *v, int f, int l) : view(v), first(f), last(l) {}
+        iterator begin() const { return iterator(view, first); }
+        iterator end() const { return iterator(view, last); }
+        size_t size() const { return last - first; }
+        bool empty() const { return first == last; }
+    };
+
+    class iterator
+    {
+    private:
+        const AdjacencyView *view;
+        int u;
+
+    public:
+        iterator(const AdjacencyView *v, int node) : view(v), u(node) {}
+        pair<int, EdgeRange> operator*() const
+        {
+            return {view->nodes[u].id, EdgeRange(view, view->csr.begin(u), view->csr.end(u))};
+        }
+        iterator &operator++()
+        {
+            u++;
+            return *this;
+        }
+        bool operator!=(const iterator &o) const { return u != o.u; }
+    };
+
+    AdjacencyView(const CSRAdjacency &c, const vector<Node> &n) : csr(c), nodes(n) {}
+    iterator begin() const { return iterator(this, 0); }
+    iterator end() const { return iterator(this, csr.nodeCount()); }
+    size_t size() const { return csr.nodeCount(); }
+};
+
+// Reverse shortest-path tree rooted at one destination city.
+// Both vectors are indexed by the node's position in GraphSnapshot::nodes.
+// nextHop[i] = index of the neighbour to move to from i (-1 at the root or if unreachable)
+// dist[i]    = remaining distance from i to the root (INF if unreachable)
+// Cities added after the tree was built have no road yet and are not stored;
+// distance() / hop() report them as unreachable.
+struct ShortestPathTree
+{
+    int root;
+    vector<int> dist;
+    vector<int> nextHop;
+
+    int distance(int v) const { return v < (int)dist.size() ? dist[v] : (v == root ? 0 : INF); }
+    int hop(int v) const { return v < (int)nextHop.size() ? nextHop[v] : -1; }
+};
+
+// Dense-index buffers for point-to-point searches. Only the entries listed in
+// 'touched' are dirty, so resetting costs O(visited) instead of O(V).
+struct SearchSpace
+{
+    vector<int> dist, parent;
+    vector<int> touched;
+
+    void prepare(int n)
+    {
+        if ((int)dist.size() != n)
+        {
+            dist.assign(n, INF);
+            parent.assign(n, -1);
+            touched.clear();
+        }
+    }
+    void reset()
+    {
+        for (int v : touched)
+        {
+            dist[v] = INF;
+            parent[v] = -1;
+        }
+        touched.clear();
+    }
+};
+
+// Calls run(queue) with this thread's queue of the given kind, reset for keys
+// that grow by at most maxStep per relaxation. The queue type becomes a
+// template parameter of the search, so there is no virtual call per operation.
+template <typename Run>
+auto withQueue(QueueKind kind, int maxStep, Run run) -> decltype(run(declval<BinaryHeapQueue &>()))
+{
+    switch (kind)
+    {
+    case QUEUE_RADIX:
+    {
+        thread_local RadixHeapQueue q;
+        q.reset(maxStep);
+        return run(q);
+    }
+    case QUEUE_DIAL:
+    {
+        thread_local DialQueue q;
+        q.reset(maxStep);
+        return run(q);
+    }
+    default:
+    {
+        thread_local BinaryHeapQueue q;
+        q.reset(maxStep);
+        return run(q);
+    }
+    }
+}
+
+// Full single-source Dijkstra over the CSR arrays. The graph is undirected,
+// so parent[v] is also v's next hop towards src.
+// Time complexity O((V + E) log V) with the binary heap, O(E + V log C) radix, O(E + D) Dial
+template <typename Queue>
+void dijkstraAll(const CSRAdjacency &g, int src, bool ignoreBlocked, vector<int> &dist, vector<int> &parent, Queue &pq)
+{
+    dist.assign(g.nodeCount(), INF);
+    parent.assign(g.nodeCount(), -1);
+    dist[src] = 0;
+    pq.push(0, src);
+
+    while (!pq.empty())
+    {
+        pair<int, int> top = pq.pop();
+        int d = top.first, u = top.second;
+        if (d > dist[u])
+            continue;
+        for (int e = g.begin(u); e < g.end(u); e++)
+        {
+            if (g.blocked[e] && !ignoreBlocked)
+                continue;
+            int v = g.target[e];
+            if (d + g.weight[e] < dist[v])
+            {
+                dist[v] = d + g.weight[e];
+                parent[v] = u;
+                pq.push(dist[v], v);
+            }
+        }
+    }
+}
+
+// Goal-directed point-to-point Dijkstra over the CSR arrays.
+// h(v) must be a consistent lower bound on the distance from v to t;
+// h = 0 gives plain Dijkstra, anything tighter is A*. The queue must have
+// been reset for steps of 2 * maxWeight (f can grow by w + h(v) - h(u) <= 2w).
+// Returns the distance to t (INF if unreachable); parents stay in 'space'
+// and 'settled' counts the nodes taken out of the queue.
+template <typename Heuristic, typename Queue>
+int searchPointToPoint(const CSRAdjacency &g, int s, int t, Heuristic h, SearchSpace &space, int &settled, Queue &pq)
+{
+    space.prepare(g.nodeCount());
+    settled = 0;
+    space.dist[s] = 0;
+    space.touched.push_back(s);
+    pq.push(h(s), s);
+
+    while (!pq.empty())
+    {
+        pair<int, int> top = pq.pop();
+        int f = top.first, u = top.second;
+        int d = space.dist[u];
+        if (f > d + h(u))
+            continue;
+        settled++;
+        if (u == t)
+            break;
+        for (int e = g.begin(u); e < g.end(u); e++)
+        {
+            if (g.blocked[e])
+                continue;
+            int v = g.target[e];
+            if (d + g.weight[e] < space.dist[v])
+            {
+                if (space.dist[v] == INF)
+                    space.touched.push_back(v);
+                space.dist[v] = d + g.weight[e];
+                space.parent[v] = u;
+                pq.push(space.dist[v] + h(v), v);
+            }
+        }
+    }
+    return space.dist[t];
+}
+
+// How getShortestPath answers a query towards a destination without a cached tree.
+enum RoutingMode
+{
+    ROUTE_TREE,     // build and cache the destination's shortest-path tree
+    ROUTE_DIJKSTRA, // plain point-to-point Dijkstra, nothing cached
+    ROUTE_CH,       // contraction hierarchy query
+    ROUTE_ASTAR,    // A* with a straight-line bound from the city coordinates
+    ROUTE_ALT       // A* with landmark / triangle inequality bounds
+};
+
+// Outcome of an incremental road update (Graph::updateRoute).
+// For every destination that had a cached tree, lists the cities whose
+// route to that destination changed; nothing else was touched.
+struct RouteUpdate
+{
+    bool found = false;
+    string cityA, cityB;              // endpoints of the changed road
+    bool costRose = false;            // blocked or made longer
+    set<string> cachedDestinations;   // trees that were repaired (or left as is)
+    map<string, set<string>> changed; // destination -> cities with a new route
+
+    // True if a package at 'current' heading to 'dest' must be re-planned.
+    // Destinations without a cached tree are unknown here and reported as not affected.
+    bool affects(const string &current, const string &dest) const
+    {
+        auto it = changed.find(dest);
+        return it != changed.end() && it->second.count(current);
+    }
+};
+
+// Union-find with union by size and path halving.
+// Time complexity O(alpha(V)) amortized per operation
+class DisjointSets
+{
+private:
+    vector<int> parent, size;
+
+public:
+    DisjointSets(int n) : parent(n), size(n, 1)
+    {
+        for (int i = 0; i < n; i++)
+            parent[i] = i;
+    }
+
+    int find(int x)
+    {
+        while (parent[x] != x)
+        {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    }
+
+    bool unite(int a, int b)
+    {
+        a = find(a);
+        b = find(b);
+        if (a == b)
+            return false;
+        if (size[a] < size[b])
+            swap(a, b);
+        parent[b] = a;
+        size[a] += size[b];
+        return true;
+    }
+};
+
+// Connected components over the unblocked roads. Two cities have the same
+// label exactly if some route joins them, so an unreachable destination is
+// recognised in O(1) before any search starts. Labelled in bulk with
+// DisjointSets; single edits relabel only the smaller side (see Graph).
+struct ComponentIndex
+{
+    vector<int> label; // node -> component id
+    vector<int> size;  // component id -> number of cities (0 once retired)
+    int count = 0;     // number of components (partitions of the network)
+
+    bool connected(int a, int b) const { return label[a] == label[b]; }
+};
+
+// Name lookups of the road network. Entries are only ever added and keep
+// their meaning (dense node indices never change and a road's edges keep
+// their position within each endpoint's list), so every version since the
+// last refreshGraph shares one index; a snapshot ignores cities and roads
+// that are newer than itself.
+class GraphIndex
+{
+public:
+    // Edge u->v is the posU-th edge of u, v->u the posV-th edge of v
+    struct Road
+    {
+        int u, v;
+        int posU, posV;
+    };
+
+private:
+    mutable shared_mutex lock;
+    map<string, int> cities;                       // name -> dense index
+    map<int, int> cityIds;                         // city id (Node::id) -> dense index
+    OpenAddressTable<RouteKey, Road, IntHash> roads; // route key -> its two edges
+
+public:
+    int findCity(const string &name) const
+    {
+        shared_lock<shared_mutex> guard(lock);
+        auto it = cities.find(name);
+        return it == cities.end() ? -1 : it->second;
+    }
+
+    int findCityId(int id) const
+    {
+        shared_lock<shared_mutex> guard(lock);
+        auto it = cityIds.find(id);
+        return it == cityIds.end() ? -1 : it->second;
+    }
+
+    bool findRoad(RouteKey key, Road &road) const
+    {
+        shared_lock<shared_mutex> guard(lock);
+        const Road *found = roads.find(key);
+        if (!found)
+            return false;
+        road = *found;
+        return true;
+    }
+
+    void addCity(const string &name, int id, int index)
+    {
+        unique_lock<shared_mutex> guard(lock);
+        cities.emplace(name, index);
+        cityIds.emplace(id, index);
+    }
+
+    // Keeps the first road stored under a key
+    void addRoad(RouteKey key, const Road &road)
+    {
+        unique_lock<shared_mutex> guard(lock);
+        if (!roads.find(key))
+            roads.insert(key, road);
+    }
+};
+
+// Memo of reverse shortest-path trees for one graph version, keyed by the
+// destination's dense index. Readers build missing trees outside the lock;
+// if two of them race for the same destination the first stored tree wins.
+// A tree is O(V), so the cache holds at most 'budget' tree nodes in total
+// (NODE_BUDGET: 16 trees at 1M cities) and drops the least recently used
+// tree to make room; readers that still hold it keep it alive.
+class TreeCache
+{
+public:
+    static constexpr size_t NODE_BUDGET = 1 << 24;
+
+private:
+    struct Slot
+    {
+        shared_ptr<const ShortestPathTree> tree;
+        mutable atomic<uint64_t> used{0}; // 'ticks' at the last lookup
+    };
+
+    mutable shared_mutex lock;
+    map<int, Slot> trees;
+    mutable atomic<uint64_t> ticks{0};
+    size_t nodes = 0; // tree nodes stored
+    size_t budget;
+
+    static size_t sizeOf(const ShortestPathTree &tree) { return max<size_t>(1, tree.dist.size()); }
+
+public:
+    explicit TreeCache(size_t budget = NODE_BUDGET) : budget(budget) {}
+
+    // Lookups only share the lock; recency is an atomic stamp
+    shared_ptr<const ShortestPathTree> find(int root) const
+    {
+        shared_lock<shared_mutex> guard(lock);
+        auto it = trees.find(root);
+        if (it == trees.end())
+            return nullptr;
+        it->second.used = ++ticks;
+        return it->second.tree;
+    }
+
+    // Time complexity O(log T), plus O(T) per tree evicted
+    shared_ptr<const ShortestPathTree> insert(int root, shared_ptr<const ShortestPathTree> tree)
+    {
+        unique_lock<shared_mutex> guard(lock);
+        auto it = trees.find(root);
+        if (it != trees.end())
+            return it->second.tree;
+        size_t size = sizeOf(*tree);
+        while (!trees.empty() && nodes + size > budget)
+        {
+            auto oldest = trees.begin();
+            for (auto jt = trees.begin(); jt != trees.end(); ++jt)
+                if (jt->second.used < oldest->second.used)
+                    oldest = jt;
+            nodes -= sizeOf(*oldest->second.tree);
+            trees.erase(oldest);
+        }
+        Slot &slot = trees[root];
+        slot.tree = tree;
+        slot.used = ++ticks;
+        nodes += size;
+        return tree;
+    }
+
+    // Every tree, least recently used first, so inserting them in this order
+    // into another cache keeps their recency.
+    vector<pair<int, shared_ptr<const ShortestPathTree>>> entries() const
+    {
+        vector<pair<uint64_t, pair<int, shared_ptr<const ShortestPathTree>>>> byUse;
+        {
+            shared_lock<shared_mutex> guard(lock);
+            for (const auto &entry : trees)
+                byUse.push_back({entry.second.used, {entry.first, entry.second.tree}});
+        }
+        sort(byUse.begin(), byUse.end(), [](const auto &a, const auto &b)
+             { return a.first < b.first; });
+        vector<pair<int, shared_ptr<const ShortestPathTree>>> result;
+        for (auto &entry : byUse)
+            result.push_back(move(entry.second));
+        return result;
+    }
+};
+
+// K shortest loopless routes (Yen) for the city pairs that are asked for
+// often, keyed by dense (source, destination), for one graph version.
+// Every route request is counted; a pair gets its alternatives once it
+// reaches the caller's threshold. Blocking a road keeps the alternatives
+// that avoid it (see withoutRoad), so re-routing around a closure is a lookup.
+//
+// Route requests only read: the stored routes are an immutable map
+// published with one atomic store (like the graph versions), and uses are
+// counted in a fixed array of atomic counters hashed by pair. Pairs that
+// share a counter get hot a little sooner, which only costs an early Yen
+// run. Writers (store, and the claim of a pair that just got hot) take a
+// mutex, so Yen runs once per pair even when several requests see it get hot.
+// At most maxPairs pairs are stored; the one requested least recently is
+// dropped first.
+class AlternativeCache
+{
+public:
+    typedef vector<pair<int, vector<int>>> Routes;
+    static constexpr size_t MAX_PAIRS = 4096;
+    static constexpr int COUNTERS = 1 << 14;
+
+private:
+    struct Slot
+    {
+        Routes routes;
+        mutable atomic<uint64_t> used{0}; // 'ticks' at the last lookup
+    };
+    typedef map<pair<int, int>, shared_ptr<const Slot>> Table;
+
+    shared_ptr<const Table> table = make_shared<Table>(); // atomic_load / atomic_store
+    unique_ptr<atomic<uint32_t>[]> uses;
+    mutable atomic<uint64_t> ticks{0};
+    mutex writeLock;
+    set<pair<int, int>> claimed; // hot pairs whose routes are being computed, guarded by writeLock
+    size_t maxPairs;
+
+    static int counterOf(int s, int t) { return mix64(makeRouteKey(s, t) ^ ((uint64_t)(s < t) << 63)) & (COUNTERS - 1); }
+
+    // Shared so that a store() dropping the pair cannot free it under us
+    shared_ptr<const Slot> lookup(int s, int t) const
+    {
+        shared_ptr<const Table> current = atomic_load(&table);
+        auto it = current->find({s, t});
+        if (it == current->end())
+            return nullptr;
+        it->second->used = ++ticks;
+        return it->second;
+    }
+
+    // Copy with the same counts and the stored pairs f(routes) keeps, their
+    // recency included. Time complexity O(COUNTERS + pairs log pairs)
+    template <class F>
+    shared_ptr<AlternativeCache> copyWith(F f) const
+    {
+        auto next = make_shared<AlternativeCache>(maxPairs);
+        for (int i = 0; i < COUNTERS; i++)
+            next->uses[i] = uses[i].load();
+        next->ticks = ticks.load();
+        auto kept = make_shared<Table>();
+        for (const auto &entry : *atomic_load(&table))
+        {
+            auto slot = make_shared<Slot>();
+            slot->routes = entry.second->routes;
+            slot->used = entry.second->used.load();
+            if (f(slot->routes))
+                kept->emplace(entry.first, slot);
+        }
+        next->table = kept;
+        return next;
+    }
+
+public:
+    explicit AlternativeCache(size_t maxPairs = MAX_PAIRS) : uses(new atomic<uint32_t>[COUNTERS]), maxPairs(maxPairs)
+    {
+        for (int i = 0; i < COUNTERS; i++)
+            uses[i] = 0;
+    }
+
+    size_t size() const { return atomic_load(&table)->size(); }
+
+    // Counts one request for s -> t. True if the pair is hot and its routes
+    // are neither stored nor claimed yet: this caller should compute them
+    // and store() them. Lock-free until the pair gets hot.
+    bool countUse(int s, int t, int hotUses)
+    {
+        if ((int)++uses[counterOf(s, t)] < hotUses)
+            return false;
+        lock_guard<mutex> guard(writeLock);
+        if (atomic_load(&table)->count({s, t}))
+            return false;
+        return claimed.insert({s, t}).second;
+    }
+
+    // Cheapest stored route; false if the pair has none. Lock-free
+    bool best(int s, int t, pair<int, vector<int>> &route) const
+    {
+        shared_ptr<const Slot> slot = lookup(s, t);
+        if (!slot || slot->routes.empty())
+            return false;
+        route = slot->routes.front();
+        return true;
+    }
+
+    bool find(int s, int t, Routes &routes) const
+    {
+        shared_ptr<const Slot> slot = lookup(s, t);
+        if (!slot)
+            return false;
+        routes = slot->routes;
+        return true;
+    }
+
+    // Keeps the routes of whoever stored first. Publishes a new map.
+    // Time complexity O(pairs)
+    void store(int s, int t, const Routes &routes)
+    {
+        lock_guard<mutex> guard(writeLock);
+        claimed.erase({s, t});
+        shared_ptr<const Table> current = atomic_load(&table);
+        if (current->count({s, t}))
+            return;
+        auto next = make_shared<Table>(*current);
+        if (next->size() >= maxPairs)
+        {
+            auto oldest = next->begin();
+            for (auto it = next->begin(); it != next->end(); ++it)
+                if (it->second->used < oldest->second->used)
+                    oldest = it;
+            next->erase(oldest);
+        }
+        auto slot = make_shared<Slot>();
+        slot->routes = routes;
+        slot->used = ++ticks;
+        next->emplace(make_pair(s, t), slot);
+        atomic_store(&table, shared_ptr<const Table>(next));
+    }
+
+    // Cache for the version in which no road between u and v is usable any
+    // more. Costs of the other routes are unchanged and every route missing
+    // from a list cost at least as much as its last entry, so the remaining
+    // routes are still the cheapest ones in order.
+    // Time complexity O(total stored route length)
+    shared_ptr<AlternativeCache> withoutRoad(int u, int v) const
+    {
+        auto drives = [&](const pair<int, vector<int>> &r)
+        {
+            for (size_t i = 1; i < r.second.size(); i++)
+                if ((r.second[i - 1] == u && r.second[i] == v) || (r.second[i - 1] == v && r.second[i] == u))
+                    return true;
+            return false;
+        };
+        // A pair left without routes recomputes on its next request
+        return copyWith([&](Routes &routes)
+                        {
+            routes.erase(remove_if(routes.begin(), routes.end(), drives), routes.end());
+            return !routes.empty(); });
+    }
+
+    // Cache for a version where routes may have become cheaper: only the
+    // request counts survive, so hot pairs recompute on their next request.
+    shared_ptr<AlternativeCache> countsOnly() const
+    {
+        return copyWith([](Routes &)
+                        { return false; });
+    }
+};
+
+// Part of the map inside a viewport (see GraphSnapshot::getMapView).
+struct MapView
+{
+    vector<int> nodes;                  // dense indices of the cities drawn one by one
+    vector<pair<int, int>> roads;       // (node, CSR slot) of every road drawn, once per road
+    vector<QuadTree::Cluster> clusters; // cities too close together to draw apart
+};
+
+// Routes for a batch of packages planned together (see GraphSnapshot::planDispatch).
+struct DispatchPlan
+{
+    vector<vector<int>> routes; // per trip, dense indices from start to destination; empty = not planned
+    vector<int> flow;           // packages planned over every CSR slot
+    long long cost = 0;         // total length of the planned routes
+};
+
+// ALT: distances from a few landmark cities, node-major (dist[v * k + i]).
+// Computed once per index on the first ALT query.
+struct LandmarkIndex
+{
+    once_flag computed;
+    vector<int> landmarks;
+    vector<int> dist;
+};
+
+// One immutable version of the road network. Graph publishes a new snapshot
+// for every change and readers pin one with Graph::pin(), so a request keeps
+// a consistent network even while another thread adds a city or blocks a
+// road. Parts that a change does not touch are shared with the previous
+// version. The only mutable parts are the lazily filled caches, which are
+// internally synchronized.
+class GraphSnapshot
+{
+    friend class Graph;
+
+private:
+    shared_ptr<const vector<Node>> nodes;
+    shared_ptr<GraphIndex> index; // shared with the other versions, see GraphIndex
+    shared_ptr<const CSRAdjacency> csr;
+
+    // Contraction hierarchy for one-off city-to-city queries, only in ROUTE_CH
+    shared_ptr<const ContractionHierarchy> ch;
+
+    // Built lazily on the first query towards a destination. A road update
+    // gives the next version its own cache holding the repaired trees.
+    shared_ptr<TreeCache> trees;
+
+    // Top-K routes of frequently requested pairs. Survives a road closure
+    // minus the routes over the closed road; any other change of the road
+    // costs keeps only the request counts.
+    static constexpr int ALTERNATIVE_COUNT = 4;
+    static constexpr int HOT_PAIR_USES = 3;
+    shared_ptr<AlternativeCache> alternatives;
+
+    // Computed with blocked roads open, i.e. on a metric that is never larger
+    // than the live one, so the bounds stay admissible when roads get blocked.
+    static constexpr int LANDMARK_COUNT = 8;
+    shared_ptr<LandmarkIndex> landmarks;
+
+    // Covers every city of this version, including ones without roads
+    shared_ptr<const ComponentIndex> components;
+
+    // Road profiles and closures (see TimeDependent.h). While any road has one,
+    // routes are earliest-arrival searches leaving at 'clock' instead of
+    // answers from the static caches above.
+    shared_ptr<const TimeTable> timetable;
+    long long clock = 0; // simulation minutes
+
+    // Road capacities per shift (see Congestion.h); the loads themselves
+    // belong to the shift being routed, not to the map version.
+    shared_ptr<const CapacityTable> capacities;
+
+    // A*: largest factor with weight >= geoScale * straight-line length on every
+    // road, so geoScale * |v t| never overestimates. 0 disables the bound.
+    double geoScale = 0.0;
+
+    // City coordinates for viewport queries, and an upper bound on the
+    // straight-line length of any road: a road crossing a box has both ends
+    // within roadSpan of it. Moving a city only ever raises the bound.
+    shared_ptr<const QuadTree> spatial;
+    double roadSpan = 0.0;
+
+    // Nearest-city lookups. Entries of cities that moved since they were
+    // inserted are stale; they no longer match the node array and are skipped.
+    shared_ptr<const KdTree> kdtree;
+
+    RoutingMode routingMode = ROUTE_TREE;
+    QueueKind queueKind = QUEUE_AUTO;
+    long version = 0;
+
+    int indexOf(const string &name) const
+    {
+        int v = index->findCity(name);
+        return v < (int)nodes->size() ? v : -1;
+    }
+
+    // Looks up a road of this version; false if unknown or added later.
+    bool findRoad(RouteKey key, GraphIndex::Road &road) const
+    {
+        return index->findRoad(key, road) && road.u < csr->nodeCount() && road.v < csr->nodeCount() &&
+               road.posU < csr->degree(road.u) && road.posV < csr->degree(road.v);
+    }
+
+    // Route between two cities as dense node indices: the best stored
+    // alternative of a hot pair, else the destination's cached tree, else a
+    // search with the selected RoutingMode.
+    pair<int, vector<int>> routeBetween(const string &startCity, const string &endCity) const
+    {
+        int start = indexOf(startCity), end = indexOf(endCity);
+        if (start == -1 || end == -1 || !components->connected(start, end))
+            return {-1, {}};
+        if (start == end)
+            return {0, {start}};
+        pair<int, vector<int>> res;
+        if (!timetable->empty())
+        {
+            // Waiting out closures always gets through within a component
+            long long arrive = earliestArrival(*csr, *timetable, start, end, clock, res.second);
+            res.first = arrive == -1 ? -1 : (int)(arrive - clock);
+            return res;
+        }
+        if (alternatives->best(start, end, res))
+            return res;
+        if (alternatives->countUse(start, end, HOT_PAIR_USES))
+        {
+            AlternativeCache::Routes routes = kShortestPaths(*csr, start, end, ALTERNATIVE_COUNT);
+            alternatives->store(start, end, routes);
+            if (!routes.empty())
+                return routes.front();
+        }
+        shared_ptr<const ShortestPathTree> tree = trees->find(end);
+        if (!tree)
+            return findPath(start, end, routingMode);
+        return pathInTree(*tree, start);
+    }
+
+    // Route from start along the tree's next hops, {-1, {}} if unreachable
+    static pair<int, vector<int>> pathInTree(const ShortestPathTree &tree, int start)
+    {
+        if (tree.distance(start) == INF)
+            return {-1, {}};
+        pair<int, vector<int>> res;
+        res.first = tree.distance(start);
+        for (int v = start; v != -1; v = tree.hop(v))
+            res.second.push_back(v);
+        return res;
+    }
+
+    // Single Dijkstra run from the destination. The graph is undirected, so the
+    // parent of every node in this search is its next hop towards the destination.
+    // Time complexity O((V + E) log V)
+    shared_ptr<const ShortestPathTree> getTree(int root) const
+    {
+        shared_ptr<const ShortestPathTree> cached = trees->find(root);
+        if (cached)
+            return cached;
+        auto tree = make_shared<ShortestPathTree>();
+        tree->root = root;
+        if (root >= csr->nodeCount())
+            return tree; // city without roads yet
+        withQueue(activeQueue(), csr->maxWeight, [&](auto &pq)
+                  { dijkstraAll(*csr, root, false, tree->dist, tree->nextHop, pq); });
+        return trees->insert(root, tree);
+    }
+
+    // Full single-source Dijkstra, used for landmark preprocessing.
+    vector<int> distancesFrom(int src, bool ignoreBlocked) const
+    {
+        vector<int> dist, parent;
+        withQueue(activeQueue(), csr->maxWeight, [&](auto &pq)
+                  { dijkstraAll(*csr, src, ignoreBlocked, dist, parent, pq); });
+        return dist;
+    }
+
+    // Farthest-point landmark selection: each new landmark is the city
+    // farthest from all landmarks chosen so far.
+    // Time complexity O(k (V + E) log V)
+    void computeLandmarks(LandmarkIndex &lm) const
+    {
+        int n = csr->nodeCount();
+        int k = min(LANDMARK_COUNT, n);
+        lm.landmarks.clear();
+        lm.dist.assign((size_t)n * k, INF);
+        vector<int> closest(n, INF);
+        int next = 0;
+        for (int i = 0; i < k; i++)
+        {
+            // The first pass from node 0 only serves to find a far-away start.
+            vector<int> dist = distancesFrom(next, true);
+            if (i == 0)
+            {
+                for (int v = 0; v < n; v++)
+                    if (dist[v] != INF && dist[v] > dist[next])
+                        next = v;
+                dist = distancesFrom(next, true);
+            }
+            lm.landmarks.push_back(next);
+            for (int v = 0; v < n; v++)
+            {
+                lm.dist[(size_t)v * k + i] = dist[v];
+                closest[v] = min(closest[v], dist[v]);
+            }
+            for (int v = 0; v < n; v++)
+                if (closest[v] != INF && (closest[next] == INF || closest[v] > closest[next]))
+                    next = v;
+        }
+    }
+
+public:
+    long getVersion() const { return version; }
+    int componentCount() const { return components->count; }
+    long long getClock() const { return clock; }
+    bool isTimeDependent() const { return !timetable->empty(); }
+    bool hasCapacities() const { return !capacities->empty(); }
+    RoutingMode getRoutingMode() const { return routingMode; }
+    // False while ROUTE_CH queries fall back to the trees (hierarchy being rebuilt)
+    bool hasHierarchy() const { return ch != nullptr; }
+    QueueKind activeQueue() const { return queueKind == QUEUE_AUTO ? chooseQueue(csr->maxWeight) : queueKind; }
+    double getGeoScale() const { return geoScale; }
+
+    // --- Pathfinding & Helpers --- Dijkistra Algorithm ---
+    // Both queries are answered from the destination's cached tree:
+    // O(1) for the next hop, O(path length) for the full route.
+    // A full route to a destination without a cached tree is answered with the
+    // selected RoutingMode, so one-off queries need not pay for a whole tree.
+
+    // Point-to-point route between dense node indices with an explicit mode.
+    // Returns {-1, {}} if unreachable, otherwise the distance and node indices
+    // from s to t. 'settled' (optional) receives the number of nodes the search
+    // settled, which is what A* / ALT are meant to cut down.
+    pair<int, vector<int>> findPath(int s, int t, RoutingMode mode, int *settled = nullptr) const
+    {
+        if (settled)
+            *settled = 0;
+        if (s == t)
+            return {0, {s}};
+        // O(1) answer for cut-off destinations (also covers cities without roads)
+        if (!components->connected(s, t))
+            return {-1, {}};
+        if (mode == ROUTE_CH && ch)
+            return ch->query(s, t);
+        if (mode == ROUTE_TREE || mode == ROUTE_CH)
+        {
+            shared_ptr<const ShortestPathTree> tree = getTree(t);
+            if (tree->distance(s) == INF)
+                return {-1, {}};
+            vector<int> path;
+            for (int v = s; v != -1; v = tree->hop(v))
+                path.push_back(v);
+            return {tree->distance(s), path};
+        }
+
+        const CSRAdjacency &g = *csr;
+        const vector<Node> &pos = *nodes;
+        thread_local SearchSpace space;
+        int count = 0, d;
+        if (mode == ROUTE_ASTAR)
+        {
+            const Node &goal = pos[t];
+            double scale = geoScale;
+            auto h = [&](int v)
+            { return (int)(scale * hypot((double)pos[v].x - goal.x, (double)pos[v].y - goal.y)); };
+            d = withQueue(activeQueue(), 2 * g.maxWeight, [&](auto &pq)
+                          { return searchPointToPoint(g, s, t, h, space, count, pq); });
+        }
+        else if (mode == ROUTE_ALT)
+        {
+            call_once(landmarks->computed, [&]()
+                      { computeLandmarks(*landmarks); });
+            // Cities added after the landmarks were computed have no bound (h = 0)
+            int k = landmarks->landmarks.size();
+            int covered = k ? landmarks->dist.size() / k : 0;
+            if (t >= covered)
+                k = 0;
+            const int *table = landmarks->dist.data();
+            const int *toT = table + (size_t)t * k;
+            auto h = [&](int v)
+            {
+                if (v >= covered)
+                    return 0;
+                const int *toV = table + (size_t)v * k;
+                int best = 0;
+                for (int i = 0; i < k; i++)
+                    if (toT[i] != INF && toV[i] != INF)
+                        best = max(best, abs(toT[i] - toV[i]));
+                return best;
+            };
+            d = withQueue(activeQueue(), 2 * g.maxWeight, [&](auto &pq)
+                          { return searchPointToPoint(g, s, t, h, space, count, pq); });
+        }
+        else
+        {
+            auto h = [](int)
+            { return 0; };
+            d = withQueue(activeQueue(), g.maxWeight, [&](auto &pq)
+                          { return searchPointToPoint(g, s, t, h, space, count, pq); });
+        }
+
+        pair<int, vector<int>> result = {-1, {}};
+        if (d != INF)
+        {
+            result.first = d;
+            for (int v = t; v != -1; v = space.parent[v])
+                result.second.push_back(v);
+            reverse(result.second.begin(), result.second.end());
+        }
+        space.reset();
+        if (settled)
+            *settled = count;
+        return result;
+    }
+
+    pair<int, vector<string>> getShortestPath(const string &startCity, const string &endCity) const
+    {
+        pair<int, vector<int>> res = routeBetween(startCity, endCity);
+        vector<string> path;
+        path.reserve(res.second.size());
+        for (int v : res.second)
+            path.push_back((*nodes)[v].name);
+        return {res.first, path};
+    }
+
+    // Same route as getShortestPath, as city ids (Node::id) instead of names.
+    // This is what gets stored with a package; names are only looked up
+    // (getCityName) when a route is shown.
+    pair<int, vector<int>> getRoute(const string &startCity, const string &endCity) const
+    {
+        pair<int, vector<int>> res = routeBetween(startCity, endCity);
+        for (int &v : res.second)
+            v = (*nodes)[v].id;
+        return res;
+    }
+
+    // Route the shift's next hops follow (getNextHop), as city ids: the path
+    // in the destination's tree, or the earliest-arrival route while roads
+    // have profiles. Shift bookkeeping uses it instead of getRoute, so it
+    // neither counts towards hot pairs nor runs Yen, and on equal-cost routes
+    // the stored route is the one packages actually take. 'tree' is the
+    // destination's tree if the caller holds it (see getNextHops).
+    // Time complexity O(route length) once the destination's tree is cached
+    pair<int, vector<int>> getTreeRoute(const string &startCity, const string &endCity,
+                                        const ShortestPathTree *tree = nullptr) const
+    {
+        int start = indexOf(startCity), end = indexOf(endCity);
+        pair<int, vector<int>> res = {-1, {}};
+        if (start == -1 || end == -1 || !components->connected(start, end))
+            return res;
+        if (start == end)
+            res = {0, {start}};
+        else if (!timetable->empty())
+        {
+            long long arrive = earliestArrival(*csr, *timetable, start, end, clock, res.second);
+            res.first = arrive == -1 ? -1 : (int)(arrive - clock);
+        }
+        else
+            res = pathInTree(tree ? *tree : *getTree(end), start);
+        for (int &v : res.second)
+            v = (*nodes)[v].id;
+        return res;
+    }
+
+    // Up to ALTERNATIVE_COUNT routes between two cities, cheapest first, as
+    // {distance, city names}. Served from the alternatives cache; a pair that
+    // has none yet gets them computed and stored here.
+    // Time complexity O(k L (V + E) log V) on a miss, O(k L) on a hit
+    vector<pair<int, vector<string>>> getAlternatives(const string &startCity, const string &endCity) const
+    {
+        vector<pair<int, vector<string>>> result;
+        int start = indexOf(startCity), end = indexOf(endCity);
+        if (start == -1 || end == -1 || !components->connected(start, end))
+            return result;
+        AlternativeCache::Routes routes;
+        if (!alternatives->find(start, end, routes))
+        {
+            routes = kShortestPaths(*csr, start, end, ALTERNATIVE_COUNT);
+            alternatives->store(start, end, routes);
+        }
+        for (const auto &r : routes)
+        {
+            vector<string> path;
+            for (int v : r.second)
+                path.push_back((*nodes)[v].name);
+            result.push_back({r.first, path});
+        }
+        return result;
+    }
+
+    // Name of the city with the given id, "" if this version does not know it.
+    string getCityName(int cityId) const
+    {
+        int v = index->findCityId(cityId);
+        return v != -1 && v < (int)nodes->size() ? (*nodes)[v].name : "";
+    }
+
+    // Batch version of getShortestPath. Pairs are grouped by a shared endpoint
+    // (whichever of source / destination occurs more often in the batch) and
+    // every group is answered from one shortest-path tree rooted at that
+    // endpoint; the graph is undirected, so a tree rooted at a source serves
+    // all of its destinations too. Trees come from the same cache as the
+    // shift routing. Results are in the order of 'pairs'. Trees only hold
+    // static costs, so with time-dependent roads every pair is searched alone.
+    // Time complexity O(R (V + E) log V + total path length), R = distinct roots
+    vector<pair<int, vector<string>>> getShortestPaths(const vector<pair<string, string>> &pairs, int *searches = nullptr) const
+    {
+        map<string, int> uses;
+        for (const auto &p : pairs)
+        {
+            uses[p.first]++;
+            uses[p.second]++;
+        }
+
+        vector<pair<int, vector<string>>> results(pairs.size(), {-1, {}});
+        // Held for the whole batch, so the cache cannot evict one in between
+        map<int, shared_ptr<const ShortestPathTree>> roots;
+        int separate = 0;
+        for (size_t i = 0; i < pairs.size(); i++)
+        {
+            const string &from = pairs[i].first, &to = pairs[i].second;
+            int a = indexOf(from), b = indexOf(to);
+            if (a == -1 || b == -1 || !components->connected(a, b))
+                continue;
+            if (!timetable->empty())
+            {
+                // Trees hold static costs; every pair gets its own search
+                separate++;
+                results[i] = getShortestPath(from, to);
+                continue;
+            }
+            bool rootAtSource = uses[from] > uses[to];
+            int root = rootAtSource ? a : b;
+            int leaf = rootAtSource ? b : a;
+            shared_ptr<const ShortestPathTree> &tree = roots[root];
+            if (!tree)
+                tree = getTree(root);
+            if (tree->distance(leaf) == INF)
+                continue;
+            vector<string> path;
+            for (int v = leaf; v != -1; v = tree->hop(v))
+                path.push_back((*nodes)[v].name);
+            if (rootAtSource)
+                reverse(path.begin(), path.end());
+            results[i] = {tree->distance(leaf), path};
+        }
+        if (searches)
+            *searches = roots.size() + separate;
+        return results;
+    }
+
+    // 'tree' is the destination's tree if the caller holds it
+    string getNextHop(const string &currentCity, const string &destCity, const ShortestPathTree *tree = nullptr) const
+    {
+        if (currentCity == destCity)
+            return currentCity;
+        int current = indexOf(currentCity), dest = indexOf(destCity);
+        if (current == -1 || dest == -1 || !components->connected(current, dest))
+            return "";
+        if (!timetable->empty())
+        {
+            vector<int> path;
+            if (earliestArrival(*csr, *timetable, current, dest, clock, path) == -1 || path.size() < 2)
+                return "";
+            // The best plan may be to wait until the road ahead reopens
+            for (int e = csr->begin(current); e < csr->end(current); e++)
+            {
+                if (csr->target[e] != path[1] || csr->blocked[e])
+                    continue;
+                const TravelSchedule *schedule = timetable->find(current, e - csr->begin(current));
+                if (!schedule || !schedule->closedAt(clock))
+                    return (*nodes)[path[1]].name;
+            }
+            return "";
+        }
+        int next = tree ? tree->hop(current) : getTree(dest)->hop(current);
+        if (next == -1)
+            return "";
+        return (*nodes)[next].name;
+    }
+
+    // Next hop when the roads out of the current city may be congested: the
+    // neighbour v with the least (load-dependent cost of the road this shift)
+    // + (static distance from v in the destination's tree), among the
+    // neighbours closer to the destination than the current city. The road taken
+    // is added to 'loads'. The tree's own hop wins every tie, so on roads
+    // without load this is getNextHop.
+    // Time complexity O(deg) once the destination's tree is cached
+    string getCongestedHop(const string &currentCity, const string &destCity, RoadLoads &loads,
+                           shared_ptr<const ShortestPathTree> tree = nullptr) const
+    {
+        if (currentCity == destCity)
+            return currentCity;
+        int current = indexOf(currentCity), dest = indexOf(destCity);
+        if (current == -1 || dest == -1 || !components->connected(current, dest))
+            return "";
+        if (!tree)
+            tree = getTree(dest);
+        int treeHop = tree->hop(current);
+        if (treeHop == -1)
+            return "";
+        int bestSlot = -1;
+        double best = 0.0;
+        // Roads to the tree's hop first; any other road has to be strictly cheaper
+        for (int pass = 0; pass < 2; pass++)
+            for (int e = csr->begin(current); e < csr->end(current); e++)
+            {
+                int v = csr->target[e];
+                // A detour has to get closer to the destination, so a package
+                // can never go round in circles
+                if (csr->blocked[e] || tree->distance(v) >= tree->distance(current) || (pass == 0) != (v == treeHop))
+                    continue;
+                double cost = loads.cost(*csr, e) + tree->distance(v);
+                if (bestSlot == -1 || cost < best)
+                {
+                    best = cost;
+                    bestSlot = e;
+                }
+            }
+        if (bestSlot == -1) // only over zero-length roads
+            return (*nodes)[treeHop].name;
+        loads.add(bestSlot);
+        return (*nodes)[csr->target[bestSlot]].name;
+    }
+
+    // getNextHop for a whole shift, results in the order of 'trips'
+    // ({current city, destination}). Trips are grouped by destination and every
+    // group is one task on 'pool' that builds the destination's tree once and
+    // reads all of its hops from it. A tree depends only on this version, so
+    // the hops are the same as from serial calls. With time-dependent roads
+    // every trip is its own earliest-arrival search and its own task.
+    // If 'trees' is given it gets each trip's destination tree (null with
+    // time-dependent roads): the caller can hold them for the rest of the
+    // shift, however many destinations the tree cache has room for.
+    // Time complexity O(D (V + E) log V / threads), D = distinct destinations
+    vector<string> getNextHops(const vector<pair<string, string>> &trips, WorkStealingPool &pool,
+                               vector<shared_ptr<const ShortestPathTree>> *trees = nullptr) const
+    {
+        vector<vector<size_t>> groups;
+        map<string, size_t> byDest;
+        for (size_t i = 0; i < trips.size(); i++)
+        {
+            if (!timetable->empty())
+            {
+                groups.push_back({i});
+                continue;
+            }
+            auto it = byDest.emplace(trips[i].second, groups.size()).first;
+            if (it->second == groups.size())
+                groups.emplace_back();
+            groups[it->second].push_back(i);
+        }
+
+        vector<string> hops(trips.size());
+        if (trees)
+            trees->assign(trips.size(), nullptr);
+        pool.run(groups.size(), [&](size_t g)
+                 {
+                     shared_ptr<const ShortestPathTree> tree;
+                     int dest = indexOf(trips[groups[g].front()].second);
+                     if (timetable->empty() && dest != -1)
+                         tree = getTree(dest);
+                     for (size_t i : groups[g])
+                     {
+                         hops[i] = getNextHop(trips[i].first, trips[i].second, tree.get());
+                         if (trees)
+                             (*trees)[i] = tree;
+                     } });
+        return hops;
+    }
+
+    // Plans the routes of a whole batch of trips at once so that no road
+    // carries more packages than its capacity (roads without one are
+    // unlimited), at the least total distance. Each destination is a
+    // single-commodity min-cost flow from the trips' start cities, solved on
+    // the capacity the destinations before it left over; destinations go in
+    // the order of their first trip, so trips should come most urgent first.
+    // Within a start city the earlier trips get the shorter routes. Trips
+    // that find no capacity left keep an empty route. Static road lengths.
+    // Time complexity O(D A (V + E) log V), D = destinations, A = augmenting paths
+    DispatchPlan planDispatch(const vector<pair<string, string>> &trips) const
+    {
+        DispatchPlan plan;
+        int n = csr->nodeCount();
+        plan.routes.resize(trips.size());
+        plan.flow.assign(csr->target.size(), 0);
+        // Unlimited roads never run out: the batch has no more packages
+        vector<long long> remaining(csr->target.size(), (long long)trips.size());
+        for (int u = 0; u < (int)capacities->byNode.size() && u < n; u++)
+            for (const auto &entry : capacities->byNode[u])
+                remaining[csr->begin(u) + entry.first] = entry.second;
+
+        vector<int> order;
+        map<int, vector<size_t>> byDest;
+        for (size_t i = 0; i < trips.size(); i++)
+        {
+            int start = indexOf(trips[i].first), dest = indexOf(trips[i].second);
+            if (start == -1 || dest == -1 || start >= n || dest >= n || !components->connected(start, dest))
+                continue;
+            if (start == dest)
+            {
+                plan.routes[i] = {start};
+                continue;
+            }
+            vector<size_t> &group = byDest[dest];
+            if (group.empty())
+                order.push_back(dest);
+            group.push_back(i);
+        }
+
+        for (int dest : order)
+        {
+            const vector<size_t> &group = byDest[dest];
+            int source = n;
+            MinCostFlow mcf(n + 1);
+            struct RoadArc
+            {
+                int u, slot, arc; // arc = position in u's list of the flow network
+            };
+            vector<RoadArc> roadArcs;
+            for (int u = 0; u < n; u++)
+                for (int e = csr->begin(u); e < csr->end(u); e++)
+                    if (!csr->blocked[e] && remaining[e] > 0 && csr->target[e] != u)
+                        roadArcs.push_back({u, e, mcf.addArc(u, csr->target[e], remaining[e], csr->weight[e])});
+            map<int, int> supply;
+            for (size_t i : group)
+                supply[indexOf(trips[i].first)]++;
+            for (const auto &s : supply)
+                mcf.addArc(source, s.first, s.second, 0);
+            mcf.solve(source, dest, group.size());
+
+            for (const RoadArc &r : roadArcs)
+            {
+                long long f = mcf.flowOn(r.u, r.arc);
+                plan.flow[r.slot] += f;
+                remaining[r.slot] -= f;
+            }
+
+            // Shortest routes first to the earliest trips of every start city
+            map<int, vector<pair<long long, vector<int>>>> routesFrom;
+            long long length;
+            for (vector<int> path = mcf.takePath(source, dest, length); !path.empty();
+                 path = mcf.takePath(source, dest, length))
+            {
+                path.erase(path.begin());
+                routesFrom[path.front()].push_back({length, path});
+            }
+            map<int, size_t> used;
+            for (auto &entry : routesFrom)
+                sort(entry.second.begin(), entry.second.end());
+            for (size_t i : group)
+            {
+                int start = indexOf(trips[i].first);
+                auto &routes = routesFrom[start];
+                size_t &k = used[start];
+                if (k == routes.size())
+                    continue;
+                plan.cost += routes[k].first;
+                plan.routes[i] = move(routes[k].second);
+                k++;
+            }
+        }
+        return plan;
+    }
+
+    static constexpr double CLUSTER_PIXELS = 40.0;
+
+    // Cities and roads inside 'box' for a canvas showing 'zoom' pixels per map
+    // unit. Cities closer than CLUSTER_PIXELS on screen come back as clusters
+    // and their roads are left out, so the answer stays about the size of the
+    // screen however large the network is. Roads that cross the box are found
+    // from the cities within roadSpan of it; their far ends are added to 'nodes'.
+    // Time complexity O(answer + cities within roadSpan of the box and their roads)
+    MapView getMapView(const MapBox &box, double zoom) const
+    {
+        MapView view;
+        double cellSize = zoom > 0 ? CLUSTER_PIXELS / zoom : numeric_limits<double>::max();
+        spatial->clusters(box, cellSize, view.nodes, view.clusters);
+        set<int> shown(view.nodes.begin(), view.nodes.end());
+        for (int u : spatial->query(box.expanded(roadSpan)))
+        {
+            const Node &a = (*nodes)[u];
+            if (u >= csr->nodeCount() || spatial->inCluster(box, cellSize, a.x, a.y))
+                continue;
+            for (int e = csr->begin(u); e < csr->end(u); e++)
+            {
+                int v = csr->target[e];
+                const Node &b = (*nodes)[v];
+                // Each road once, from its lower endpoint (both are in range)
+                if (v < u || !box.intersectsSegment(a.x, a.y, b.x, b.y) || spatial->inCluster(box, cellSize, b.x, b.y))
+                    continue;
+                view.roads.push_back({u, e});
+                for (int x : {u, v})
+                    if (shown.insert(x).second)
+                        view.nodes.push_back(x);
+            }
+        }
+        return view;
+    }
+    // Bounding box of all cities.
+    MapBox getBounds() const { return spatial->bounds(); }
+
+    // Up to k cities closest to (x, y) as {dense index, straight-line
+    // distance}, nearest first. With 'reachableFrom' set only cities that
+    // have a route to that city count, e.g. alternate hubs for a destination
+    // that cannot be reached; none if it is unknown.
+    // Time complexity O(log^2 V + k log V)
+    vector<pair<int, double>> nearestCities(double x, double y, int k, const string &reachableFrom = "") const
+    {
+        int from = reachableFrom.empty() ? -1 : indexOf(reachableFrom);
+        if (!reachableFrom.empty() && from == -1)
+            return {};
+        auto accept = [&](int v, float px, float py)
+        {
+            if (v >= (int)nodes->size() || (*nodes)[v].x != px || (*nodes)[v].y != py)
+                return false;
+            return from == -1 || components->connected(from, v);
+        };
+        vector<pair<int, double>> result;
+        for (const auto &hit : kdtree->nearest(x, y, k, accept))
+            result.push_back({hit.second, sqrt(hit.first)});
+        return result;
+    }
+
+    // Returning the nodes.
+    const vector<Node> &getNodes() const { return *nodes; }
+    // returning the edges, viewed as {nodeId, edges} pairs.
+    // The view borrows from this snapshot, keep it pinned while iterating.
+    AdjacencyView getAdjList() const { return AdjacencyView(*csr, *nodes); }
+    // Raw CSR arrays for the routing code (dense node indices).
+    const CSRAdjacency &getCSR() const { return *csr; }
+    const CapacityTable &getCapacities() const { return *capacities; }
+};
+
+// Writer side of the road network. Every change builds a new GraphSnapshot
+// from the current one and publishes it with an atomic pointer swap; readers
+// never block on a writer. Writers are serialized by writeLock.
 class Graph
 {
 private:
     SimpleHash &cityRef;
     hashroutes &routeRef;
-    map<int, string> idToName;
-    map<string, int> nameToId;
-    map<int, vector<Edge>> adjList;
-    vector<Node> nodes;
 
-    // Screen Dimensions (Used only for centering new nodes)
-    const float WIDTH = 1000.0f;
-    const float HEIGHT = 800.0f;
+    shared_ptr<const GraphSnapshot> current;
+    mutex writeLock;
+    vector<char> inSubtree; // scratch marks for repairIncrease, always left all-zero
+    vector<int> visitMark;  // scratch marks for splitComponents, valid where equal to a current stamp
+    int visitStamp = 0;
+
+    map<RouteKey, TravelSchedule> schedules; // source of every version's TimeTable
+    map<RouteKey, int> capacities;           // source of every version's CapacityTable
+
+    // Distance oracle (see HubLabels.h). A worker thread builds it from a
+    // pinned version and swaps it in with an atomic store; it is used only
+    // while it matches the current edge arrays, so queries never wait for a
+    // rebuild and fall back to a normal search until it is done.
+    struct LabelIndex
+    {
+        shared_ptr<const CSRAdjacency> csr; // edges the labels were built from
+        HubLabels labels;
+    };
+    // Mutable: const readers start the worker on the first distance query
+    mutable shared_ptr<const LabelIndex> labelIndex;
+    mutable thread labelWorker;
+    mutable mutex labelLock;
+    mutable condition_variable labelWake;
+    mutable atomic<bool> labelsWanted{false};
+    mutable bool labelsDirty = false, labelsStop = false; // guarded by labelLock
+
+    // Contraction hierarchy after a new road (see addEdge). Rebuilding it is
+    // a whole preprocessing pass, so the road is published without one (ROUTE_CH
+    // queries fall back to the trees) and a second worker builds it from a
+    // pinned version and swaps it in.
+    thread hierarchyWorker;
+    mutex hierarchyLock;
+    condition_variable hierarchyWake;
+    bool hierarchyDirty = false, hierarchyStop = false; // guarded by hierarchyLock
+
+    // Asks the worker for labels of the current version, starting it on first use.
+    void requestLabels() const
+    {
+        lock_guard<mutex> guard(labelLock);
+        labelsWanted = true;
+        labelsDirty = true;
+        if (!labelWorker.joinable())
+            labelWorker = thread(&Graph::labelLoop, this);
+        labelWake.notify_one();
+    }
+
+    // Requests made during a build are merged into one more build.
+    void labelLoop() const
+    {
+        unique_lock<mutex> guard(labelLock);
+        while (true)
+        {
+            labelWake.wait(guard, [&]()
+                           { return labelsDirty || labelsStop; });
+            if (labelsStop)
+                return;
+            labelsDirty = false;
+            guard.unlock();
+
+            shared_ptr<const GraphSnapshot> snap = pin();
+            auto built = make_shared<LabelIndex>();
+            built->csr = snap->csr;
+            // Hubs in contraction order, from the snapshot's hierarchy if it has one
+            vector<int> order = snap->ch ? snap->ch->importanceOrder() : vector<int>();
+            if ((int)order.size() != snap->csr->nodeCount())
+            {
+                ContractionHierarchy ch;
+                ch.build(*snap->csr);
+                order = ch.importanceOrder();
+            }
+            built->labels.build(*snap->csr, order);
+            atomic_store(&labelIndex, shared_ptr<const LabelIndex>(built));
+            guard.lock();
+        }
+    }
+
+    void requestHierarchy()
+    {
+        lock_guard<mutex> guard(hierarchyLock);
+        hierarchyDirty = true;
+        if (!hierarchyWorker.joinable())
+            hierarchyWorker = thread(&Graph::hierarchyLoop, this);
+        hierarchyWake.notify_one();
+    }
+
+    void hierarchyLoop()
+    {
+        unique_lock<mutex> guard(hierarchyLock);
+        while (true)
+        {
+            hierarchyWake.wait(guard, [&]()
+                               { return hierarchyDirty || hierarchyStop; });
+            if (hierarchyStop)
+                return;
+            hierarchyDirty = false;
+            guard.unlock();
+
+            shared_ptr<const GraphSnapshot> snap = pin();
+            if (snap->routingMode == ROUTE_CH && !snap->ch)
+            {
+                auto ch = make_shared<ContractionHierarchy>();
+                ch->build(*snap->csr);
+                lock_guard<mutex> lock(writeLock);
+                // Weight and block changes since the pin only need the new
+                // metric; another new road (or a reload) needs another pass.
+                if (current->routingMode == ROUTE_CH && !current->ch)
+                {
+                    if (current->index == snap->index && current->csr->arcCount == snap->csr->arcCount)
+                    {
+                        ch->customize(*current->csr);
+                        auto next = draft();
+                        next->ch = ch;
+                        publish(next);
+                    }
+                    else
+                    {
+                        lock_guard<mutex> again(hierarchyLock);
+                        hierarchyDirty = true;
+                    }
+                }
+            }
+            guard.lock();
+        }
+    }
+
+    // Labels of snap's edges, or null (and a rebuild requested) if they are missing or stale.
+    shared_ptr<const LabelIndex> freshLabels(const GraphSnapshot &snap) const
+    {
+        shared_ptr<const LabelIndex> index = atomic_load(&labelIndex);
+        if (index && index->csr == snap.csr)
+            return index;
+        if (!labelsWanted)
+            requestLabels();
+        return nullptr;
+    }
+
+    // Screen Dimensions (Used only for centering new nodes)
+    const float WIDTH = 1000.0f;
+    const float HEIGHT = 800.0f;
+
+    // Attaches the schedules to the edges of 'snap'. Roads unknown to it are
+    // skipped; they get theirs once they are added.
+    // Time complexity O(S log R), S = scheduled roads
+    shared_ptr<const TimeTable> buildTimeTable(const GraphSnapshot &snap) const
+    {
+        auto table = make_shared<TimeTable>();
+        table->byNode.resize(snap.csr->nodeCount());
+        for (const auto &entry : schedules)
+        {
+            GraphIndex::Road road;
+            if (entry.second.empty() || !snap.findRoad(entry.first, road))
+                continue;
+            int id = table->schedules.size();
+            table->schedules.push_back(entry.second);
+            table->byNode[road.u].push_back({road.posU, id});
+            table->byNode[road.v].push_back({road.posV, id});
+        }
+        if (table->schedules.empty())
+            table->byNode.clear();
+        return table;
+    }
+
+    // Attaches the capacities to the edges of 'snap', like buildTimeTable.
+    // Time complexity O(C log R), C = capped roads
+    shared_ptr<const CapacityTable> buildCapacityTable(const GraphSnapshot &snap) const
+    {
+        auto table = make_shared<CapacityTable>();
+        table->byNode.resize(snap.csr->nodeCount());
+        bool any = false;
+        for (const auto &entry : capacities)
+        {
+            GraphIndex::Road road;
+            if (entry.second <= 0 || !snap.findRoad(entry.first, road))
+                continue;
+            table->byNode[road.u].push_back({road.posU, entry.second});
+            table->byNode[road.v].push_back({road.posV, entry.second});
+            any = true;
+        }
+        if (!any)
+            table->byNode.clear();
+        return table;
+    }
+
+    // Starts the next version as a copy of the current one (shares every part).
+    shared_ptr<GraphSnapshot> draft() const
+    {
+        return make_shared<GraphSnapshot>(*current);
+    }
+
+    void publish(shared_ptr<GraphSnapshot> next)
+    {
+        next->version = current ? current->version + 1 : 1;
+        bool edgesChanged = !current || next->csr != current->csr;
+        atomic_store(&current, shared_ptr<const GraphSnapshot>(next));
+        if (edgesChanged && labelsWanted)
+            requestLabels();
+    }
+
+    static double computeGeoScale(const vector<Node> &nodes, const CSRAdjacency &csr)
+    {
+        double scale = -1.0;
+        for (int u = 0; u < csr.nodeCount(); u++)
+            for (int e = csr.begin(u); e < csr.end(u); e++)
+            {
+                double ratio = roadScale(nodes[u], nodes[csr.target[e]], csr.weight[e]);
+                if (ratio >= 0.0 && (scale < 0.0 || ratio < scale))
+                    scale = ratio;
+            }
+        return scale < 0.0 ? 0.0 : scale;
+    }
+
+    static double longestRoad(const vector<Node> &nodes, const CSRAdjacency &csr)
+    {
+        double span = 0.0;
+        for (int u = 0; u < csr.nodeCount(); u++)
+            for (int e = csr.begin(u); e < csr.end(u); e++)
+                span = max(span, roadLength(nodes[u], nodes[csr.target[e]]));
+        return span;
+    }
+
+    static shared_ptr<const QuadTree> buildSpatial(const vector<Node> &nodes)
+    {
+        vector<int> ids(nodes.size());
+        vector<pair<double, double>> coords(nodes.size());
+        for (size_t v = 0; v < nodes.size(); v++)
+        {
+            ids[v] = v;
+            coords[v] = {nodes[v].x, nodes[v].y};
+        }
+        auto tree = make_shared<QuadTree>();
+        tree->build(ids, coords);
+        return tree;
+    }
+
+    static shared_ptr<const KdTree> buildKdTree(const vector<Node> &nodes)
+    {
+        vector<int> ids(nodes.size());
+        vector<pair<float, float>> coords(nodes.size());
+        for (size_t v = 0; v < nodes.size(); v++)
+        {
+            ids[v] = v;
+            coords[v] = {nodes[v].x, nodes[v].y};
+        }
+        auto tree = make_shared<KdTree>();
+        tree->build(ids, coords);
+        return tree;
+    }
+
+    // --- Dynamic shortest paths (Ramalingam-Reps) ---
+    // After one road changes cost, only the part of a tree that depends on
+    // that road is recomputed. 'cost' is the road's effective weight (INF when blocked).
+
+    // O(1) check whether a cost change of road u-v can alter tree t at all.
+    static bool needsRepair(const ShortestPathTree &t, int u, int v, int oldCost, int newCost)
+    {
+        int du = t.distance(u), dv = t.distance(v);
+        if (newCost < oldCost)
+            return (dv != INF && dv + newCost < du) || (du != INF && du + newCost < dv);
+        return (t.hop(u) == v && du == dv + oldCost) || (t.hop(v) == u && dv == du + oldCost);
+    }
+
+    // The road became cheaper: seed its endpoints if the road now gives them a
+    // shorter route, then push the improvement outwards Dijkstra-style.
+    // Time complexity O(K log K), K = nodes whose distance improves
+    static void repairDecrease(const CSRAdjacency &csr, ShortestPathTree &t, int u, int v, int cost, vector<int> &changed)
+    {
+        priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq;
+        auto seed = [&](int a, int b)
+        {
+            if (t.dist[b] != INF && t.dist[b] + cost < t.dist[a])
+            {
+                t.dist[a] = t.dist[b] + cost;
+                t.nextHop[a] = b;
+                pq.push({t.dist[a], a});
+            }
+        };
+        seed(u, v);
+        seed(v, u);
+
+        while (!pq.empty())
+        {
+            int d = pq.top().first;
+            int x = pq.top().second;
+            pq.pop();
+            if (d > t.dist[x])
+                continue;
+            changed.push_back(x);
+            for (int e = csr.begin(x); e < csr.end(x); e++)
+            {
+                if (csr.blocked[e])
+                    continue;
+                int y = csr.target[e];
+                if (d + csr.weight[e] < t.dist[y])
+                {
+                    t.dist[y] = d + csr.weight[e];
+                    t.nextHop[y] = x;
+                    pq.push({t.dist[y], y});
+                }
+            }
+        }
+    }
+
+    // The road became more expensive: only matters if it is a tree edge. The
+    // subtree hanging below it loses its distances, is re-seeded from its
+    // unaffected neighbours and settled again with a Dijkstra restricted to it.
+    // Time complexity O(S log S + deg(S)), S = size of the subtree below the road
+    void repairIncrease(const CSRAdjacency &csr, ShortestPathTree &t, int u, int v, int oldCost, vector<int> &changed)
+    {
+        int child;
+        if (t.nextHop[u] == v && t.dist[u] == t.dist[v] + oldCost)
+            child = u;
+        else if (t.nextHop[v] == u && t.dist[v] == t.dist[u] + oldCost)
+            child = v;
+        else
+            return;
+
+        // 1. Collect the subtree: y belongs to it if its next hop does.
+        vector<int> sub = {child};
+        inSubtree[child] = 1;
+        for (size_t i = 0; i < sub.size(); i++)
+        {
+            int x = sub[i];
+            for (int e = csr.begin(x); e < csr.end(x); e++)
+            {
+                int y = csr.target[e];
+                if (!inSubtree[y] && t.nextHop[y] == x)
+                {
+                    inSubtree[y] = 1;
+                    sub.push_back(y);
+                }
+            }
+        }
+
+        // 2. Forget the old routes and seed every node from outside the subtree.
+        vector<pair<int, int>> old;
+        old.reserve(sub.size());
+        for (int x : sub)
+        {
+            old.push_back({t.dist[x], t.nextHop[x]});
+            t.dist[x] = INF;
+            t.nextHop[x] = -1;
+        }
+        priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq;
+        for (int x : sub)
+        {
+            for (int e = csr.begin(x); e < csr.end(x); e++)
+            {
+                int z = csr.target[e];
+                if (csr.blocked[e] || inSubtree[z] || t.dist[z] == INF)
+                    continue;
+                if (t.dist[z] + csr.weight[e] < t.dist[x])
+                {
+                    t.dist[x] = t.dist[z] + csr.weight[e];
+                    t.nextHop[x] = z;
+                }
+            }
+            if (t.dist[x] != INF)
+                pq.push({t.dist[x], x});
+        }
+
+        // 3. Settle the subtree.
+        while (!pq.empty())
+        {
+            int d = pq.top().first;
+            int x = pq.top().second;
+            pq.pop();
+            if (d > t.dist[x])
+                continue;
+            for (int e = csr.begin(x); e < csr.end(x); e++)
+            {
+                int y = csr.target[e];
+                if (csr.blocked[e] || !inSubtree[y])
+                    continue;
+                if (d + csr.weight[e] < t.dist[y])
+                {
+                    t.dist[y] = d + csr.weight[e];
+                    t.nextHop[y] = x;
+                    pq.push({t.dist[y], y});
+                }
+            }
+        }
+
+        for (size_t i = 0; i < sub.size(); i++)
+        {
+            int x = sub[i];
+            if (old[i].first != t.dist[x] || old[i].second != t.nextHop[x])
+                changed.push_back(x);
+            inSubtree[x] = 0;
+        }
+    }
+
+    static double roadLength(const Node &a, const Node &b)
+    {
+        return hypot((double)a.x - b.x, (double)a.y - b.y);
+    }
+
+    // Largest factor f with weight >= f * |ab| for one road, -1 if a and b coincide.
+    static double roadScale(const Node &a, const Node &b, int weight)
+    {
+        double len = roadLength(a, b);
+        if (len <= 0.0)
+            return -1.0;
+        // Safety margin against floating point rounding
+        return weight / len * (1.0 - 1e-9);
+    }
+
+    // Appends edge u->v and returns its position in u's list. When the slots
+    // reserved for u are used up, u's edges move to the end of the arrays with
+    // twice the room (or grow in place if they are already last), so adding
+    // edges costs O(1) amortized plus O(deg) per move. Vacated slots stay
+    // unused until the next compact().
+    static int appendEdge(CSRAdjacency &g, int u, int v, int weight, bool isBlocked)
+    {
+        if (g.finish[u] == g.limit[u])
+        {
+            int deg = g.degree(u);
+            int room = max(2, 2 * deg);
+            int size = g.target.size();
+            int start = g.limit[u] == size ? g.offset[u] : size;
+            g.target.resize(start + room);
+            g.weight.resize(start + room);
+            g.blocked.resize(start + room);
+            if (start != g.offset[u])
+            {
+                for (int i = 0; i < deg; i++)
+                {
+                    g.target[start + i] = g.target[g.offset[u] + i];
+                    g.weight[start + i] = g.weight[g.offset[u] + i];
+                    g.blocked[start + i] = g.blocked[g.offset[u] + i];
+                }
+                g.offset[u] = start;
+                g.finish[u] = start + deg;
+            }
+            g.limit[u] = start + room;
+        }
+        int slot = g.finish[u]++;
+        g.target[slot] = v;
+        g.weight[slot] = weight;
+        g.blocked[slot] = isBlocked;
+        g.arcCount++;
+        g.maxWeight = max(g.maxWeight, weight);
+        return slot - g.offset[u];
+    }
+
+    // Brings the cached trees of 'next' up to date after the effective cost of
+    // road u-v changed from oldCost to newCost (INF = blocked / missing).
+    // Trees that do not use the road are shared with the previous version.
+    void repairTrees(GraphSnapshot &next, int u, int v, int oldCost, int newCost, RouteUpdate &update)
+    {
+        const vector<Node> &nodes = *next.nodes;
+        shared_ptr<TreeCache> previous = next.trees;
+        if (oldCost != newCost)
+            next.trees = make_shared<TreeCache>();
+        int n = next.csr->nodeCount();
+        inSubtree.resize(n, 0);
+
+        for (auto &entry : previous->entries())
+        {
+            string dest = nodes[entry.first].name;
+            update.cachedDestinations.insert(dest);
+            if (oldCost == newCost)
+                continue;
+
+            shared_ptr<const ShortestPathTree> tree = entry.second;
+            if (needsRepair(*tree, u, v, oldCost, newCost))
+            {
+                // Readers of the old version may still hold the tree, so it is copied.
+                auto repaired = make_shared<ShortestPathTree>(*tree);
+                repaired->dist.resize(n, INF);
+                repaired->nextHop.resize(n, -1);
+                if (repaired->root < n)
+                    repaired->dist[repaired->root] = 0;
+                vector<int> changed;
+                if (newCost < oldCost)
+                    repairDecrease(*next.csr, *repaired, u, v, newCost, changed);
+                else
+                    repairIncrease(*next.csr, *repaired, u, v, oldCost, changed);
+                for (int x : changed)
+                    update.changed[dest].insert(nodes[x].name);
+                tree = repaired;
+            }
+            next.trees->insert(entry.first, tree);
+        }
+    }
+
+    // --- Connected components ---
+
+    // Labels the components of the unblocked roads in bulk.
+    // Time complexity O((V + E) alpha(V))
+    static shared_ptr<ComponentIndex> labelComponents(const CSRAdjacency &csr, int n)
+    {
+        DisjointSets sets(n);
+        for (int u = 0; u < csr.nodeCount(); u++)
+            for (int e = csr.begin(u); e < csr.end(u); e++)
+                if (!csr.blocked[e])
+                    sets.unite(u, csr.target[e]);
+
+        auto comp = make_shared<ComponentIndex>();
+        comp->label.assign(n, -1);
+        for (int v = 0; v < n; v++)
+        {
+            int root = sets.find(v);
+            if (comp->label[root] == -1)
+            {
+                comp->label[root] = comp->size.size();
+                comp->size.push_back(0);
+            }
+            comp->label[v] = comp->label[root];
+            comp->size[comp->label[v]]++;
+        }
+        comp->count = comp->size.size();
+        return comp;
+    }
+
+    // Road u-v became usable. If it joins two components the smaller one is
+    // relabelled by a BFS that stays inside it; small-to-large means a city is
+    // relabelled O(log V) times over any sequence of joins.
+    static void joinComponents(ComponentIndex &comp, const CSRAdjacency &csr, int u, int v)
+    {
+        int small = comp.label[u], large = comp.label[v];
+        if (small == large)
+            return;
+        if (comp.size[small] > comp.size[large])
+        {
+            swap(small, large);
+            swap(u, v);
+        }
+        vector<int> queue = {u};
+        comp.label[u] = large;
+        for (size_t i = 0; i < queue.size(); i++)
+        {
+            int x = queue[i];
+            for (int e = csr.begin(x); e < csr.end(x); e++)
+            {
+                int y = csr.target[e];
+                if (!csr.blocked[e] && comp.label[y] == small)
+                {
+                    comp.label[y] = large;
+                    queue.push_back(y);
+                }
+            }
+        }
+        comp.size[large] += comp.size[small];
+        comp.size[small] = 0;
+        comp.count--;
+    }
+
+    // Road u-v stopped being usable. Two BFS from u and v take turns (the one
+    // with fewer cities goes next); if they meet the component is still whole,
+    // otherwise the side that runs out first is the part that was cut off and
+    // gets a new label. The work is proportional to the smaller part.
+    void splitComponents(ComponentIndex &comp, const CSRAdjacency &csr, int u, int v)
+    {
+        if (u == v || comp.label[u] != comp.label[v])
+            return;
+        visitMark.resize(csr.nodeCount(), 0);
+        int mark[2];
+        mark[0] = ++visitStamp;
+        mark[1] = ++visitStamp;
+        vector<int> side[2] = {{u}, {v}};
+        size_t head[2] = {0, 0};
+        visitMark[u] = mark[0];
+        visitMark[v] = mark[1];
+        while (head[0] < side[0].size() && head[1] < side[1].size())
+        {
+            int k = side[0].size() <= side[1].size() ? 0 : 1;
+            int x = side[k][head[k]++];
+            for (int e = csr.begin(x); e < csr.end(x); e++)
+            {
+                if (csr.blocked[e])
+                    continue;
+                int y = csr.target[e];
+                if (visitMark[y] == mark[1 - k])
+                    return; // still connected
+                if (visitMark[y] != mark[k])
+                {
+                    visitMark[y] = mark[k];
+                    side[k].push_back(y);
+                }
+            }
+        }
+        const vector<int> &cut = head[0] == side[0].size() ? side[0] : side[1];
+        int id = comp.size.size();
+        comp.size[comp.label[u]] -= cut.size();
+        comp.size.push_back(cut.size());
+        for (int x : cut)
+            comp.label[x] = id;
+        comp.count++;
+    }
 
-    pair<string, string> parseRouteKey(string key)
+    // Body of setEdgeWeight / setEdgeBlocked / updateRoute, writeLock must be held.
+    // A negative weight or blocked flag keeps the road's current one.
+    // Time complexity O(E) copy of the edge arrays for the new version, plus the
+    // tree repairs and a hierarchy customization if the cost changed
+    RouteUpdate changeRoute(RouteKey routeKey, int newWeight, int newBlocked)
     {
-        size_t dash = key.find('-');
-        if (dash != string::npos)
-            return {key.substr(0, dash), key.substr(dash + 1)};
-        return {"", ""};
+        RouteUpdate update;
+        GraphIndex::Road road;
+        if (!current->findRoad(routeKey, road))
+            return update;
+
+        auto next = draft();
+        auto csr = make_shared<CSRAdjacency>(*current->csr);
+        int u = road.u, v = road.v;
+        int forward = csr->begin(u) + road.posU, backward = csr->begin(v) + road.posV;
+        int oldWeight = csr->weight[forward];
+        int weight = newWeight < 0 ? oldWeight : newWeight;
+        bool isBlocked = newBlocked < 0 ? csr->blocked[forward] != 0 : newBlocked != 0;
+        int oldCost = csr->blocked[forward] ? INF : oldWeight;
+        int newCost = isBlocked ? INF : weight;
+        csr->weight[forward] = csr->weight[backward] = weight;
+        csr->blocked[forward] = csr->blocked[backward] = isBlocked;
+        csr->maxWeight = max(csr->maxWeight, weight);
+        next->csr = csr;
+
+        const vector<Node> &nodes = *next->nodes;
+        update.found = true;
+        update.cityA = nodes[u].name;
+        update.cityB = nodes[v].name;
+        update.costRose = newCost > oldCost;
+        if (next->ch && oldCost != newCost)
+        {
+            // Copies only the metric; the contraction order stays shared
+            auto ch = make_shared<ContractionHierarchy>(*next->ch);
+            ch->customize(*csr);
+            next->ch = ch;
+        }
+        if (weight < oldWeight)
+        {
+            // A longer road keeps the old A* factor valid (just less tight);
+            // a shorter one may lower it.
+            double scale = roadScale(nodes[u], nodes[v], weight);
+            if (scale >= 0.0)
+                next->geoScale = min(next->geoScale, scale);
+            // Landmark distances ignore blocking, so only a shorter road invalidates them
+            next->landmarks = make_shared<LandmarkIndex>();
+        }
+
+        if ((oldCost == INF) != (newCost == INF))
+        {
+            auto comp = make_shared<ComponentIndex>(*next->components);
+            if (newCost == INF)
+                splitComponents(*comp, *csr, u, v);
+            else
+                joinComponents(*comp, *csr, u, v);
+            next->components = comp;
+        }
+
+        // Only a closure that leaves no usable road between u and v keeps the
+        // other alternatives exact.
+        if (newCost > oldCost && roadCost(*csr, u, v) == INF)
+            next->alternatives = next->alternatives->withoutRoad(u, v);
+        else if (newCost != oldCost)
+            next->alternatives = next->alternatives->countsOnly();
+
+        repairTrees(*next, u, v, oldCost, newCost, update);
+        publish(next);
+        return update;
     }
 
 public:
@@ -56,14 +2121,56 @@ public:
         refreshGraph();
     }
 
+    ~Graph()
+    {
+        {
+            lock_guard<mutex> guard(labelLock);
+            labelsStop = true;
+        }
+        labelWake.notify_one();
+        if (labelWorker.joinable())
+            labelWorker.join();
+        {
+            lock_guard<mutex> guard(hierarchyLock);
+            hierarchyStop = true;
+        }
+        hierarchyWake.notify_one();
+        if (hierarchyWorker.joinable())
+            hierarchyWorker.join();
+    }
+
+    // Pins the current version. The snapshot stays valid (and unchanged) for
+    // as long as the caller holds it, whatever writers do meanwhile.
+    shared_ptr<const GraphSnapshot> pin() const
+    {
+        return atomic_load(&current);
+    }
+
     // Completely non-physics refresh
+    // Reloads everything from the hash tables; single edits should use
+    // addNode / addEdge / setEdgeWeight / setEdgeBlocked instead.
     void refreshGraph()
     {
-        nodes.clear();
-        adjList.clear();
-        idToName.clear();
-        nameToId.clear();
-        vector<City> cityData = cityRef.getAll();
+        load(cityRef.getAll(), routeRef.getAllRoutes());
+    }
+
+    // Replaces the whole network by the given cities and routes (what
+    // refreshGraph reads from the hash tables). Also used to load generated
+    // networks that are too large for them, e.g. by the benchmarks.
+    // Time complexity O((V + E) log V)
+    void load(const vector<City> &cityData, const vector<RouteEntry> &routeData)
+    {
+        lock_guard<mutex> lock(writeLock);
+        auto next = make_shared<GraphSnapshot>();
+        if (current)
+        {
+            next->routingMode = current->routingMode;
+            next->queueKind = current->queueKind;
+            next->clock = current->clock;
+        }
+        auto nodes = make_shared<vector<Node>>();
+        auto index = make_shared<GraphIndex>();
+        auto csr = make_shared<CSRAdjacency>();
 
         for (const auto &c : cityData)
         {
@@ -86,114 +2193,442 @@ public:
                 n.y = static_cast<float>(rand() % (int)HEIGHT);
             }
 
-            nodes.push_back(n);
-            idToName[n.id] = n.name;
-            nameToId[n.name] = n.id;
+            index->addCity(n.name, n.id, nodes->size());
+            nodes->push_back(n);
         }
 
         // Build Connections (Edges)
-        for (const auto &r : routeRef.getAllRoutes())
+        // Each route becomes two directed arcs; they are counted per node first
+        // and then scattered into the CSR arrays (counting sort by source).
+        struct Arc
         {
-            pair<string, string> cities = parseRouteKey(r.key);
-            if (nameToId.count(cities.first) && nameToId.count(cities.second))
+            int from, to, weight;
+            bool isBlocked;
+        };
+        vector<Arc> arcs;
+        vector<RouteKey> arcKeys; // route key of every forward arc
+        set<RouteKey> seen;
+        capacities.clear();
+        for (const auto &r : routeData)
+        {
+            if (r.capacity > 0)
+                capacities[r.key] = r.capacity;
+            int u = index->findCityId(routeLow(r.key)), v = index->findCityId(routeHigh(r.key));
+            if (u != -1 && v != -1 && seen.insert(r.key).second)
             {
-                int u = nameToId[cities.first];
-                int v = nameToId[cities.second];
-                adjList[u].push_back({v, r.distance, r.isBlocked});
-                adjList[v].push_back({u, r.distance, r.isBlocked});
+                arcs.push_back({u, v, r.distance, r.isBlocked});
+                arcs.push_back({v, u, r.distance, r.isBlocked});
+                arcKeys.push_back(r.key);
             }
         }
+
+        int n = nodes->size();
+        csr->offset.assign(n, 0);
+        for (const auto &a : arcs)
+            csr->offset[a.from]++;
+        for (int u = 0, sum = 0; u < n; u++)
+        {
+            int deg = csr->offset[u];
+            csr->offset[u] = sum;
+            sum += deg;
+        }
+
+        csr->target.resize(arcs.size());
+        csr->weight.resize(arcs.size());
+        csr->blocked.resize(arcs.size());
+        csr->finish = csr->offset;
+        vector<int> pos(arcs.size()); // position of every arc in its source's list
+        for (size_t i = 0; i < arcs.size(); i++)
+        {
+            const Arc &a = arcs[i];
+            int slot = csr->finish[a.from]++;
+            csr->target[slot] = a.to;
+            csr->weight[slot] = a.weight;
+            csr->blocked[slot] = a.isBlocked;
+            csr->maxWeight = max(csr->maxWeight, a.weight);
+            pos[i] = slot - csr->offset[a.from];
+        }
+        csr->limit = csr->finish;
+        csr->arcCount = arcs.size();
+        for (size_t k = 0; k < arcKeys.size(); k++)
+            index->addRoad(arcKeys[k], {arcs[2 * k].from, arcs[2 * k].to, pos[2 * k], pos[2 * k + 1]});
+        inSubtree.assign(n, 0);
+
+        next->geoScale = computeGeoScale(*nodes, *csr);
+        next->roadSpan = longestRoad(*nodes, *csr);
+        next->spatial = buildSpatial(*nodes);
+        next->kdtree = buildKdTree(*nodes);
+        next->nodes = nodes;
+        next->index = index;
+        next->csr = csr;
+        next->trees = make_shared<TreeCache>();
+        next->alternatives = make_shared<AlternativeCache>();
+        next->landmarks = make_shared<LandmarkIndex>();
+        next->components = labelComponents(*csr, n);
+        if (next->routingMode == ROUTE_CH)
+        {
+            auto ch = make_shared<ContractionHierarchy>();
+            ch->build(*csr);
+            ch->customize(*csr);
+            next->ch = ch;
+        }
+        next->timetable = buildTimeTable(*next);
+        next->capacities = buildCapacityTable(*next);
+        publish(next);
+    }
+
+    // --- Incremental edits ---
+    // Each one publishes a new version that differs from the current one by a
+    // single city or road; caches that cannot be affected are shared as is.
+
+    // Adds a city without roads and returns it (the existing node if the name
+    // is taken). A 0 coordinate gets a random position like in refreshGraph.
+    // Nothing cached depends on an isolated city: trees, landmarks and the
+    // hierarchy report cities newer than themselves as unreachable.
+    // Time complexity O(V) for the new version's node array, O(log V) otherwise
+    Node addNode(const string &name, int id, float x = 0.0f, float y = 0.0f)
+    {
+        lock_guard<mutex> lock(writeLock);
+        int existing = current->indexOf(name);
+        if (existing != -1)
+            return (*current->nodes)[existing];
+
+        Node n;
+        n.id = id;
+        n.name = name;
+        n.x = x;
+        n.y = y;
+        if (x == 0.0f || y == 0.0f)
+        {
+            n.x = static_cast<float>(rand() % (int)WIDTH);
+            n.y = static_cast<float>(rand() % (int)HEIGHT);
+        }
+
+        auto next = draft();
+        auto nodes = make_shared<vector<Node>>(*current->nodes);
+        current->index->addCity(name, id, nodes->size());
+        auto spatial = make_shared<QuadTree>(*current->spatial);
+        spatial->insert(nodes->size(), n.x, n.y);
+        next->spatial = spatial;
+        auto kdtree = make_shared<KdTree>(*current->kdtree);
+        kdtree->insert(nodes->size(), n.x, n.y);
+        next->kdtree = kdtree;
+        nodes->push_back(n);
+        next->nodes = nodes;
+        auto comp = make_shared<ComponentIndex>(*current->components);
+        comp->label.push_back(comp->size.size());
+        comp->size.push_back(1);
+        comp->count++;
+        next->components = comp;
+        publish(next);
+        return n;
+    }
+
+    // Adds a road between two known cities. An existing key only changes the
+    // road's weight / block state (like setEdgeWeight). The new road is a cost
+    // decrease from "missing" to its weight, so cached trees are repaired
+    // incrementally; a road that is already one of the hierarchy's shortcuts
+    // only re-customizes it, any other one leaves the rebuild to the
+    // hierarchy worker. Returns found = false if a city is unknown.
+    // Time complexity O(E) copy of the edge arrays, O(deg) amortized to insert
+    RouteUpdate addEdge(RouteKey routeKey, int weight, bool isBlocked = false)
+    {
+        lock_guard<mutex> lock(writeLock);
+        GraphIndex::Road road;
+        if (current->findRoad(routeKey, road))
+            return changeRoute(routeKey, weight, isBlocked);
+
+        RouteUpdate update;
+        int u = current->index->findCityId(routeLow(routeKey)), v = current->index->findCityId(routeHigh(routeKey));
+        if (u == -1 || v == -1 || u == v || u >= (int)current->nodes->size() || v >= (int)current->nodes->size())
+            return update;
+
+        auto next = draft();
+        const vector<Node> &nodes = *next->nodes;
+        auto csr = make_shared<CSRAdjacency>(*current->csr);
+        // Cities added since the last edge get their (empty) CSR entries now
+        while (csr->nodeCount() < (int)nodes.size())
+        {
+            csr->offset.push_back(csr->target.size());
+            csr->finish.push_back(csr->target.size());
+            csr->limit.push_back(csr->target.size());
+        }
+        bool firstRoad = csr->arcCount == 0;
+        road.u = u;
+        road.v = v;
+        road.posU = appendEdge(*csr, u, v, weight, isBlocked);
+        road.posV = appendEdge(*csr, v, u, weight, isBlocked);
+        if ((int)csr->target.size() > 2 * csr->arcCount + 1024)
+            csr->compact();
+        next->csr = csr;
+        current->index->addRoad(routeKey, road);
+
+        update.found = true;
+        update.cityA = nodes[u].name;
+        update.cityB = nodes[v].name;
+        bool rebuild = next->ch && !next->ch->hasArc(u, v);
+        if (rebuild)
+            next->ch = nullptr;
+        else if (next->ch)
+        {
+            auto ch = make_shared<ContractionHierarchy>(*next->ch);
+            ch->customize(*csr);
+            next->ch = ch;
+        }
+        double scale = roadScale(nodes[u], nodes[v], weight);
+        if (scale >= 0.0)
+            next->geoScale = firstRoad ? scale : min(next->geoScale, scale);
+        next->roadSpan = max(next->roadSpan, roadLength(nodes[u], nodes[v]));
+        next->landmarks = make_shared<LandmarkIndex>();
+
+        if (!isBlocked)
+        {
+            auto comp = make_shared<ComponentIndex>(*next->components);
+            joinComponents(*comp, *csr, u, v);
+            next->components = comp;
+            next->alternatives = next->alternatives->countsOnly();
+        }
+        if (schedules.count(routeKey))
+            next->timetable = buildTimeTable(*next);
+        if (capacities.count(routeKey))
+            next->capacities = buildCapacityTable(*next);
+
+        repairTrees(*next, u, v, INF, isBlocked ? INF : weight, update);
+        publish(next);
+        // After publishing: the worker pins the version it rebuilds
+        if (rebuild)
+            requestHierarchy();
+        return update;
+    }
+
+    RouteUpdate setEdgeWeight(RouteKey routeKey, int weight)
+    {
+        lock_guard<mutex> lock(writeLock);
+        return changeRoute(routeKey, weight, -1);
+    }
+
+    RouteUpdate setEdgeBlocked(RouteKey routeKey, bool isBlocked)
+    {
+        lock_guard<mutex> lock(writeLock);
+        return changeRoute(routeKey, -1, isBlocked);
+    }
+
+    // Changes one road's weight and block state at once; see changeRoute.
+    // Returns found = false if the key is not a road of the current graph.
+    RouteUpdate updateRoute(RouteKey routeKey, int weight, bool isBlocked)
+    {
+        lock_guard<mutex> lock(writeLock);
+        return changeRoute(routeKey, weight, isBlocked);
+    }
+
+    // --- Time-dependent roads ---
+    // Replaces a road's profile and closures; an empty schedule makes it
+    // static again. Accepted for roads that are not added yet.
+    // Time complexity O(S log R) to re-attach all schedules
+    void setSchedule(RouteKey routeKey, TravelSchedule schedule)
+    {
+        lock_guard<mutex> lock(writeLock);
+        schedule.normalize();
+        if (schedule.empty())
+            schedules.erase(routeKey);
+        else
+            schedules[routeKey] = schedule;
+        auto next = draft();
+        next->timetable = buildTimeTable(*next);
+        publish(next);
+    }
+
+    void setSchedules(const map<RouteKey, TravelSchedule> &all)
+    {
+        lock_guard<mutex> lock(writeLock);
+        schedules.clear();
+        for (const auto &entry : all)
+            if (!entry.second.empty())
+                schedules[entry.first] = entry.second;
+        auto next = draft();
+        next->timetable = buildTimeTable(*next);
+        publish(next);
+    }
+
+    // --- Congestion ---
+    // Packages per shift a road takes in each direction, 0 = unlimited.
+    // Accepted for roads that are not added yet.
+    // Time complexity O(C log R) to re-attach all capacities
+    void setCapacity(RouteKey routeKey, int capacity)
+    {
+        lock_guard<mutex> lock(writeLock);
+        if (capacity > 0)
+            capacities[routeKey] = capacity;
+        else
+            capacities.erase(routeKey);
+        auto next = draft();
+        next->capacities = buildCapacityTable(*next);
+        publish(next);
+    }
+
+    // Moves the simulation clock that time-dependent routes leave at.
+    void setClock(long long minute)
+    {
+        lock_guard<mutex> lock(writeLock);
+        auto next = draft();
+        next->clock = minute;
+        publish(next);
+    }
+
+    long long getClock() const { return pin()->getClock(); }
+
+    // Selects how queries towards destinations without a cached tree are
+    // answered. Switching to ROUTE_CH costs one preprocessing pass; afterwards
+    // refreshGraph rebuilds the hierarchy and road updates only re-customize it.
+    // ALT landmarks are computed on the first ALT query.
+    void setRoutingMode(RoutingMode mode)
+    {
+        lock_guard<mutex> lock(writeLock);
+        auto next = draft();
+        if (mode == ROUTE_CH && !next->ch)
+        {
+            auto ch = make_shared<ContractionHierarchy>();
+            ch->build(*next->csr);
+            ch->customize(*next->csr);
+            next->ch = ch;
+        }
+        else if (mode != ROUTE_CH)
+            next->ch = nullptr;
+        next->routingMode = mode;
+        publish(next);
+    }
+    RoutingMode getRoutingMode() const { return pin()->getRoutingMode(); }
+
+    // Priority queue used by the Dijkstra / A* searches. QUEUE_AUTO picks the
+    // Dial bucket queue for short roads and the radix heap otherwise.
+    void setQueueKind(QueueKind kind)
+    {
+        lock_guard<mutex> lock(writeLock);
+        auto next = draft();
+        next->queueKind = kind;
+        publish(next);
     }
+    QueueKind activeQueue() const { return pin()->activeQueue(); }
+    int componentCount() const { return pin()->componentCount(); }
+    double getGeoScale() const { return pin()->getGeoScale(); }
 
     // Save current positions (X,Y) to the Database Cache
     void syncToHash()
     {
-        for (const auto &n : nodes)
+        for (const auto &n : pin()->getNodes())
         {
             cityRef.updatePosition(n.name, n.x, n.y);
         }
     }
 
     // Update a single node's position (Called when dragging drops)
+    // Only the node array and the quadtree path of the city are copied and
+    // the city is added to the k-d tree again; roads, trees and landmarks are
+    // shared. The A* factor can only need
+    // lowering, and the longest road growing, for the roads of the moved city.
+    // Time complexity O(V) for the new node array, O(deg) otherwise
     void updateNodePos(string name, float x, float y)
     {
-        if (nameToId.count(name))
-        {
-            int id = nameToId[name];
-            for (auto &n : nodes)
+        lock_guard<mutex> lock(writeLock);
+        int v = current->indexOf(name);
+        if (v == -1)
+            return;
+        auto next = draft();
+        auto nodes = make_shared<vector<Node>>(*current->nodes);
+        auto spatial = make_shared<QuadTree>(*current->spatial);
+        spatial->move(v, (*nodes)[v].x, (*nodes)[v].y, x, y);
+        next->spatial = spatial;
+        (*nodes)[v].x = x;
+        (*nodes)[v].y = y;
+        auto kdtree = make_shared<KdTree>(*current->kdtree);
+        kdtree->markStale();
+        kdtree->insert(v, x, y);
+        next->kdtree = kdtree->needsRebuild() ? buildKdTree(*nodes) : kdtree;
+        const CSRAdjacency &csr = *next->csr;
+        if (v < csr.nodeCount())
+            for (int e = csr.begin(v); e < csr.end(v); e++)
             {
-                if (n.id == id)
-                {
-                    n.x = x;
-                    n.y = y;
-                    break;
-                }
+                double scale = roadScale((*nodes)[v], (*nodes)[csr.target[e]], csr.weight[e]);
+                if (scale >= 0.0)
+                    next->geoScale = min(next->geoScale, scale);
+                next->roadSpan = max(next->roadSpan, roadLength((*nodes)[v], (*nodes)[csr.target[e]]));
             }
-        }
+        next->nodes = nodes;
+        publish(next);
+    }
+
+    // Drops every cached shortest-path tree and alternative route.
+    void invalidateRoutes()
+    {
+        lock_guard<mutex> lock(writeLock);
+        auto next = draft();
+        next->trees = make_shared<TreeCache>();
+        next->alternatives = next->alternatives->countsOnly();
+        publish(next);
     }
 
-    // --- Pathfinding & Helpers (Unchanged) --- Dijkistra Algorithm ---
+    // Queries on the current version (see GraphSnapshot). Callers that make
+    // several related queries should pin() once instead.
+    pair<int, vector<int>> findPath(int s, int t, RoutingMode mode, int *settled = nullptr) const
+    {
+        return pin()->findPath(s, t, mode, settled);
+    }
+    pair<int, vector<string>> getShortestPath(string startCity, string endCity) const
+    {
+        return pin()->getShortestPath(startCity, endCity);
+    }
+    pair<int, vector<int>> getRoute(const string &startCity, const string &endCity) const
+    {
+        return pin()->getRoute(startCity, endCity);
+    }
+    vector<pair<int, vector<string>>> getAlternatives(const string &startCity, const string &endCity) const
+    {
+        return pin()->getAlternatives(startCity, endCity);
+    }
 
-    pair<int, vector<string>> getShortestPath(string startCity, string endCity)
+    // Road distance between two cities for pricing / ETA, -1 if unreachable.
+    // Answered by a label merge when the hub labels are up to date, otherwise
+    // by a normal (static) search on the current version while the labels
+    // are rebuilt in the background. 'fromLabels' tells which one it was.
+    // Time complexity O(|L(s)| + |L(t)|) from the labels
+    int getDistance(const string &startCity, const string &endCity, bool *fromLabels = nullptr) const
     {
-        if (!nameToId.count(startCity) || !nameToId.count(endCity))
-            return {-1, {}};
-        int start = nameToId[startCity], end = nameToId[endCity];
-        map<int, int> dist;
-        map<int, int> parent;
-        for (const auto &node : nodes)
-            dist[node.id] = INF;
-
-        dist[start] = 0;
-        parent[start] = -1;
-        priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq;
-        pq.push({0, start});
+        shared_ptr<const GraphSnapshot> snap = pin();
+        int s = snap->indexOf(startCity), t = snap->indexOf(endCity);
+        shared_ptr<const LabelIndex> index = freshLabels(*snap);
+        if (fromLabels)
+            *fromLabels = index != nullptr;
+        if (s == -1 || t == -1)
+            return -1;
+        if (index)
+            return index->labels.distance(s, t);
+        return snap->findPath(s, t, snap->routingMode).first;
+    }
 
-        while (!pq.empty())
-        {
-            int d = pq.top().first;
-            int u = pq.top().second;
-            pq.pop();
-            if (d > dist[u])
-                continue;
-            if (u == end)
-                break;
-            for (const auto &edge : adjList[u])
-            {
-                if (edge.isBlocked)
-                    continue;
-                if (dist[u] + edge.weight < dist[edge.to])
-                {
-                    dist[edge.to] = dist[u] + edge.weight;
-                    parent[edge.to] = u;
-                    pq.push({dist[edge.to], edge.to});
-                }
-            }
-        }
-        if (dist[end] == INF)
+    // Same with the route, rebuilt from the label parents.
+    pair<int, vector<string>> getDistancePath(const string &startCity, const string &endCity, bool *fromLabels = nullptr) const
+    {
+        shared_ptr<const GraphSnapshot> snap = pin();
+        int s = snap->indexOf(startCity), t = snap->indexOf(endCity);
+        shared_ptr<const LabelIndex> index = freshLabels(*snap);
+        if (fromLabels)
+            *fromLabels = index != nullptr;
+        if (s == -1 || t == -1)
             return {-1, {}};
+        pair<int, vector<int>> res = index ? index->labels.path(s, t) : snap->findPath(s, t, snap->routingMode);
         vector<string> path;
-        for (int v = end; v != -1; v = parent[v])
-            path.push_back(idToName[v]);
-        reverse(path.begin(), path.end());
-        return {dist[end], path};
+        for (int v : res.second)
+            path.push_back(snap->getNodes()[v].name);
+        return {res.first, path};
     }
-
-    string getNextHop(string currentCity, string destCity)
+    vector<pair<int, vector<string>>> getShortestPaths(const vector<pair<string, string>> &pairs, int *searches = nullptr) const
     {
-        if (currentCity == destCity)
-            return currentCity;
-        pair<int, vector<string>> result = getShortestPath(currentCity, destCity);
-        if (result.first != -1 && result.second.size() >= 2)
-        {
-            return result.second[1];
-        }
-        return "";
+        return pin()->getShortestPaths(pairs, searches);
+    }
+    string getNextHop(string currentCity, string destCity) const
+    {
+        return pin()->getNextHop(currentCity, destCity);
     }
-    // Returning the nodes.
-    const vector<Node> &getNodes() const { return nodes; }
-    // returning the map with the edges.
-    const map<int, vector<Edge>> &getAdjList() const { return adjList; }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -3,98 +3,864 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include "Epoch.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FASTGO_SSE2
+#endif
 
 using namespace std;
 
-enum Status
+// MurmurHash3 64-bit finalizer: every input bit affects the low bits the
+// tables use as slot index.
+inline uint64_t mix64(uint64_t h)
 {
-    EMPTY,
-    OCCUPIED,
-    DELETED
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// 64-bit string hash: FNV-1a over the bytes, then mix64 so that every byte
+// (and its position) affects the slot index. Anagrams do not collide.
+// Time complexity O(length)
+inline uint64_t hashString(string_view key)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for (unsigned char c : key)
+    {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return mix64(h);
+}
+
+// Hash policy for string keys. Takes a string_view, so a table keyed by
+// string can be searched with a string_view or a char* without building a
+// string first.
+struct StringHash
+{
+    uint64_t operator()(string_view key) const { return hashString(key); }
 };
 
-struct RouteEntry
+// Hash policy for integer keys (route keys): just the finalizer
+struct IntHash
 {
-    string key;
-    int distance;
-    bool isBlocked;
-    Status status;
+    uint64_t operator()(uint64_t key) const { return mix64(key); }
 };
 
-class hashroutes
+const double DEFAULT_MAX_LOAD = 0.75;
+
+// One control byte per slot: EMPTY, DELETED (tombstone) or, for a full slot,
+// the low 7 bits of its key's hash (the fingerprint). A group of 16 bytes is
+// compared against a fingerprint with one SSE2 instruction (a scalar loop
+// without SSE2), so whole keys are only compared at the slots that match,
+// 1 in 128 of the others on average.
+class ControlBytes
 {
+public:
+    static constexpr int GROUP = 16;
+    static constexpr int8_t CTRL_EMPTY = -128;
+    static constexpr int8_t CTRL_DELETED = -2;
+
 private:
-    int size;
-    int count;
-    vector<RouteEntry> table;
+    vector<int8_t> ctrl;
+    int groups = 0;
 
 public:
-    hashroutes() : size(97), count(0)
+    // 'slots' is a power of two >= GROUP
+    void reset(int slots)
     {
-        table.resize(size, {"", -1, false, EMPTY});
+        ctrl.assign(slots, CTRL_EMPTY);
+        groups = slots / GROUP;
     }
 
-    // HELPER FUNCTION TO CONVERT STRING INTO THE INT 
-    int computekey(const string &key) const
+    int groupCount() const { return groups; }
+    bool full(int slot) const { return ctrl[slot] >= 0; }
+    int8_t get(int slot) const { return ctrl[slot]; }
+    void set(int slot, int8_t value) { ctrl[slot] = value; }
+
+    static int8_t fingerprint(uint64_t hash) { return hash & 0x7F; }
+
+    // Bit k set = slot k of the group has control byte 'value'
+    uint32_t match(int group, int8_t value) const { return matchBytes(&ctrl[group * GROUP], value); }
+    uint32_t matchEmpty(int group) const { return matchBytes(&ctrl[group * GROUP], CTRL_EMPTY); }
+    uint32_t matchFree(int group) const { return freeBytes(&ctrl[group * GROUP]); }
+
+    // The same on a group of 16 bytes anywhere (ConcurrentTable keeps its
+    // control bytes in atomic words and copies a group out first)
+    static uint32_t matchBytes(const int8_t *g, int8_t value)
     {
-        int sum = 0;
-        for (char c : key)
-            sum += c;
-        return sum % size;
+#ifdef FASTGO_SSE2
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(g));
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(value)));
+#else
+        uint32_t bits = 0;
+        for (int k = 0; k < GROUP; k++)
+            if (g[k] == value)
+                bits |= 1u << k;
+        return bits;
+#endif
     }
 
-    // Insertion of the routes
-    // Time complexity O(1)
-    // SPACE COMPLEXITY O(1)
-    bool insert(const string &key, int distance, bool isBlocked = false)
+    // EMPTY or DELETED: the bytes with the sign bit set
+    static uint32_t freeBytes(const int8_t *g)
     {
-        int computedkey = computekey(key);
-        int firstDeletedIndex = -1;
+#ifdef FASTGO_SSE2
+        return _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(g)));
+#else
+        uint32_t bits = 0;
+        for (int k = 0; k < GROUP; k++)
+            if (g[k] < 0)
+                bits |= 1u << k;
+        return bits;
+#endif
+    }
 
-        for (int i = 0; i < size; i++)
+    static int lowestBit(uint32_t bits)
+    {
+#ifdef __GNUC__
+        return __builtin_ctz(bits);
+#else
+        int k = 0;
+        while (!(bits & 1))
         {
-            int index = (computedkey + i + (i * i)) % size;
+            bits >>= 1;
+            k++;
+        }
+        return k;
+#endif
+    }
+};
+
+inline int tableSizeFor(int wanted)
+{
+    int size = ControlBytes::GROUP;
+    while (size < wanted)
+        size *= 2;
+    return size;
+}
 
-            if (table[index].status == OCCUPIED && table[index].key == key)
+// Probe policies for OpenAddressTable.
+// Linear and quadratic probing move over whole 16-slot groups of control
+// bytes (Swiss table) and stop at the first group with an EMPTY byte;
+// removals leave tombstones. Quadratic takes triangular steps (g, g+1, g+3,
+// g+6, ...), which visit every group once for a power-of-two group count.
+struct LinearProbe
+{
+    static constexpr bool robinHood = false;
+    static int next(int group, int) { return group + 1; }
+};
+
+struct QuadraticProbe
+{
+    static constexpr bool robinHood = false;
+    static int next(int group, int i) { return group + i; }
+};
+
+// Robin Hood probes slot by slot: an entry that is further from its home
+// slot takes the place of one that is closer, so probe lengths stay even and
+// a lookup can stop as soon as it is further from home than the entry it
+// passes. Removals shift the following entries back (no tombstones).
+struct RobinHoodProbe
+{
+    static constexpr bool robinHood = true;
+};
+
+// Open-addressing hash table for one thread at a time (the graph's road
+// index uses it behind its lock). The number of
+// slots is a power of two; once occupied plus deleted slots would pass
+// 'maxLoad' of the table it is rehashed: doubled if it is really that full,
+// otherwise rebuilt at the same size to drop the tombstones. That keeps
+// probe sequences short, so operations are O(1) on average.
+//
+// Lookups take any key type the Hash accepts and Key compares equal to
+// (e.g. string_view for string keys).
+template <class Key, class Value, class Hash = StringHash, class Probe = QuadraticProbe>
+class OpenAddressTable
+{
+private:
+    struct Slot
+    {
+        Key key;
+        Value value;
+    };
+
+    int slotCount;
+    int count = 0; // occupied slots
+    int used = 0;  // occupied + deleted slots
+    double maxLoad;
+    vector<Slot> slots;
+    ControlBytes ctrl;
+    vector<int> distance; // Robin Hood only: slots away from the home slot
+    Hash hasher;
+
+    int homeSlot(uint64_t h) const { return (h >> 7) & (slotCount - 1); }
+    int homeGroup(uint64_t h) const { return (h >> 7) & (ctrl.groupCount() - 1); }
+
+    template <class K>
+    int findSlot(const K &key) const
+    {
+        uint64_t h = hasher(key);
+        int8_t fp = ControlBytes::fingerprint(h);
+        if constexpr (Probe::robinHood)
+        {
+            for (int i = 0, s = homeSlot(h); i < slotCount; i++, s = (s + 1) & (slotCount - 1))
             {
-                table[index].distance = distance;
-                table[index].isBlocked = isBlocked;
-                return true;
+                if (!ctrl.full(s) || distance[s] < i)
+                    return -1;
+                if (ctrl.get(s) == fp && slots[s].key == key)
+                    return s;
             }
-            if (table[index].status == DELETED && firstDeletedIndex == -1)
-                firstDeletedIndex = index;
-            if (table[index].status == EMPTY)
+        }
+        else
+        {
+            int g = homeGroup(h);
+            for (int i = 1; i <= ctrl.groupCount(); i++)
             {
-                if (firstDeletedIndex != -1)
-                    index = firstDeletedIndex;
-                table[index] = {key, distance, isBlocked, OCCUPIED};
-                count++;
-                return true;
+                for (uint32_t m = ctrl.match(g, fp); m; m &= m - 1)
+                {
+                    int s = g * ControlBytes::GROUP + ControlBytes::lowestBit(m);
+                    if (slots[s].key == key)
+                        return s;
+                }
+                if (ctrl.matchEmpty(g))
+                    return -1;
+                g = Probe::next(g, i) & (ctrl.groupCount() - 1);
             }
         }
-        return false;
+        return -1;
     }
 
-    bool blockRoute(const string &key) { return updateBlockStatus(key, true); }
-    bool unblockRoute(const string &key) { return updateBlockStatus(key, false); }
+    // Stores a key that is not in the table yet; there is room.
+    void place(Slot entry, uint64_t h)
+    {
+        int8_t fp = ControlBytes::fingerprint(h);
+        count++;
+        if constexpr (Probe::robinHood)
+        {
+            used++;
+            for (int s = homeSlot(h), dist = 0;; s = (s + 1) & (slotCount - 1), dist++)
+            {
+                if (!ctrl.full(s))
+                {
+                    slots[s] = move(entry);
+                    ctrl.set(s, fp);
+                    distance[s] = dist;
+                    return;
+                }
+                if (distance[s] < dist)
+                {
+                    // Take the slot of the richer entry and carry that one on
+                    swap(slots[s], entry);
+                    int8_t other = ctrl.get(s);
+                    ctrl.set(s, fp);
+                    fp = other;
+                    swap(distance[s], dist);
+                }
+            }
+        }
+        else
+        {
+            int g = homeGroup(h);
+            for (int i = 1;; i++)
+            {
+                uint32_t m = ctrl.matchFree(g);
+                if (m)
+                {
+                    int s = g * ControlBytes::GROUP + ControlBytes::lowestBit(m);
+                    if (ctrl.get(s) == ControlBytes::CTRL_EMPTY)
+                        used++;
+                    slots[s] = move(entry);
+                    ctrl.set(s, fp);
+                    return;
+                }
+                g = Probe::next(g, i) & (ctrl.groupCount() - 1);
+            }
+        }
+    }
 
-    // Updating the status of roads
-    // Complexity is O(1)
-    bool updateBlockStatus(const string &key, bool status)
+    void reset(int newSize)
+    {
+        slotCount = newSize;
+        count = used = 0;
+        slots.assign(slotCount, Slot());
+        ctrl.reset(slotCount);
+        if (Probe::robinHood)
+            distance.assign(slotCount, 0);
+    }
+
+    // Time complexity O(n)
+    void rehash(int newSize)
     {
-        int computedkey = computekey(key);
-        for (int i = 0; i < size; i++)
+        vector<Slot> old;
+        old.swap(slots);
+        ControlBytes oldCtrl = ctrl;
+        reset(newSize);
+        for (size_t s = 0; s < old.size(); s++)
+            if (oldCtrl.full(s))
+            {
+                uint64_t h = hasher(old[s].key);
+                place(move(old[s]), h);
+            }
+    }
+
+public:
+    explicit OpenAddressTable(int initialSize = 97, double loadFactor = DEFAULT_MAX_LOAD)
+        : maxLoad(loadFactor)
+    {
+        reset(tableSizeFor(initialSize));
+    }
+
+    int size() const { return count; }
+    int capacity() const { return slotCount; }
+
+    // nullptr if the key is not in the table. O(1) on average
+    template <class K>
+    Value *find(const K &key)
+    {
+        int s = findSlot(key);
+        return s == -1 ? nullptr : &slots[s].value;
+    }
+
+    template <class K>
+    const Value *find(const K &key) const
+    {
+        int s = findSlot(key);
+        return s == -1 ? nullptr : &slots[s].value;
+    }
+
+    // Adds the key or replaces its value; true if the key was new.
+    // Time complexity O(1) amortized
+    bool insert(const Key &key, Value value)
+    {
+        int s = findSlot(key);
+        if (s != -1)
         {
-            int index = (computedkey + i + (i * i)) % size;
-            if (table[index].status == EMPTY)
-                return false;
-            if (table[index].status == OCCUPIED && table[index].key == key)
+            slots[s].value = move(value);
+            return false;
+        }
+        if (used + 1 > maxLoad * slotCount)
+            rehash(count + 1 > maxLoad * slotCount / 2 ? slotCount * 2 : slotCount);
+        place({key, move(value)}, hasher(key));
+        return true;
+    }
+
+    // Time complexity O(1) on average
+    template <class K>
+    bool erase(const K &key)
+    {
+        int s = findSlot(key);
+        if (s == -1)
+            return false;
+        count--;
+        if constexpr (Probe::robinHood)
+        {
+            // Pull the displaced entries after it one slot closer to home
+            for (int next = (s + 1) & (slotCount - 1); ctrl.full(next) && distance[next] > 0;
+                 s = next, next = (next + 1) & (slotCount - 1))
             {
-                table[index].isBlocked = status;
-                return true;
+                slots[s] = move(slots[next]);
+                ctrl.set(s, ctrl.get(next));
+                distance[s] = distance[next] - 1;
+            }
+            used--;
+            ctrl.set(s, ControlBytes::CTRL_EMPTY);
+        }
+        else
+            ctrl.set(s, ControlBytes::CTRL_DELETED);
+        slots[s] = Slot();
+        return true;
+    }
+
+    // f(key, value) for every entry, in slot order. Time complexity O(capacity)
+    template <class F>
+    void forEach(F f) const
+    {
+        for (int s = 0; s < slotCount; s++)
+            if (ctrl.full(s))
+                f(slots[s].key, slots[s].value);
+    }
+};
+
+// Hash table behind SimpleHash and hashroutes, for the server's worker
+// threads: lookups take no lock and never wait for a writer.
+//
+// Slots are probed as in OpenAddressTable: groups of 16 control bytes
+// (EMPTY, DELETED or the 7-bit fingerprint) matched with one SSE2 compare
+// and walked by the same Probe policy (linear or quadratic; Robin Hood moves
+// entries, which a reader without a lock could not follow). The control
+// bytes live in atomic 64-bit words, two per group, which a probe copies
+// out before matching.
+//
+// Every entry (hash, key, value) is immutable and lives on the heap; a slot
+// holds an atomic pointer to it. Writers never change an entry: they publish
+// a changed copy with one atomic store and retire the old entry (see
+// Epoch.h), so a reader that still holds it can finish. Writers lock one of
+// STRIPES mutexes picked by the hash, so writers of different keys mostly
+// run in parallel. Keys of different stripes share groups, so a writer
+// claims a free slot with a compare-and-swap on its control byte and only
+// then stores the pointer; a fingerprint hit is confirmed through the
+// pointer, which is null while a slot is being filled or emptied. Control
+// bytes never go back to EMPTY, so a lookup can stop at the first group that
+// has an EMPTY byte.
+//
+// Growing takes every stripe, moves the entry pointers into a new slot
+// array, publishes it and retires the old array; readers that are still
+// probing the old one see the same entries there.
+template <class Key, class Value, class Hash = StringHash, class Probe = QuadraticProbe>
+class ConcurrentTable
+{
+    static_assert(!Probe::robinHood, "Robin Hood probing moves entries under lock-free readers");
+
+public:
+    static constexpr int STRIPES = 64;
+
+private:
+    static constexpr int GROUP = ControlBytes::GROUP;
+
+    struct Entry
+    {
+        uint64_t hash;
+        Key key;
+        Value value;
+    };
+
+    struct Array
+    {
+        int slotCount;
+        int groups;
+        unique_ptr<atomic<Entry *>[]> slots;
+        unique_ptr<atomic<uint64_t>[]> ctrl; // 8 control bytes per word, in slot order
+
+        explicit Array(int n)
+            : slotCount(n), groups(n / GROUP), slots(new atomic<Entry *>[n]), ctrl(new atomic<uint64_t>[n / 8])
+        {
+            int8_t bytes[8];
+            fill(bytes, bytes + 8, ControlBytes::CTRL_EMPTY);
+            uint64_t empty;
+            memcpy(&empty, bytes, 8);
+            for (int s = 0; s < n; s++)
+                slots[s].store(nullptr, memory_order_relaxed);
+            for (int w = 0; w < n / 8; w++)
+                ctrl[w].store(empty, memory_order_relaxed);
+        }
+
+        // Copies the 16 control bytes of group g into 'out'
+        void loadGroup(int g, int8_t *out) const
+        {
+            uint64_t words[2] = {ctrl[2 * g].load(), ctrl[2 * g + 1].load()};
+            memcpy(out, words, GROUP);
+        }
+
+        // edit(byte) changes slot s's control byte in place, or returns
+        // false to leave it; retried if a neighbour in the word changes.
+        template <class F>
+        bool editCtrl(int s, F edit)
+        {
+            atomic<uint64_t> &word = ctrl[s / 8];
+            uint64_t seen = word.load();
+            while (true)
+            {
+                int8_t bytes[8];
+                memcpy(bytes, &seen, 8);
+                if (!edit(bytes[s % 8]))
+                    return false;
+                uint64_t next;
+                memcpy(&next, bytes, 8);
+                if (word.compare_exchange_weak(seen, next))
+                    return true;
+            }
+        }
+    };
+
+    atomic<Array *> array;
+    atomic<int> count{0}; // live entries
+    atomic<int> used{0};  // slots ever claimed in the current array (live + DELETED)
+    double maxLoad;
+    mutable mutex stripes[STRIPES];
+    Hash hasher;
+
+    static int homeGroup(const Array &a, uint64_t h) { return (h >> 7) & (a.groups - 1); }
+    static mutex &stripeOf(mutex *locks, uint64_t h) { return locks[h >> 58]; }
+
+    // Slot of the key in 'a' and its entry, -1 if it is not there. Readers
+    // call it pinned, writers with the key's stripe locked.
+    // Time complexity O(1) on average
+    template <class K>
+    static int locate(const Array &a, const K &key, uint64_t h, Entry *&found)
+    {
+        int8_t fp = ControlBytes::fingerprint(h);
+        int8_t group[GROUP];
+        int g = homeGroup(a, h);
+        for (int i = 1; i <= a.groups; i++)
+        {
+            a.loadGroup(g, group);
+            for (uint32_t m = ControlBytes::matchBytes(group, fp); m; m &= m - 1)
+            {
+                int s = g * GROUP + ControlBytes::lowestBit(m);
+                Entry *e = a.slots[s].load();
+                if (e && e->hash == h && e->key == key)
+                {
+                    found = e;
+                    return s;
+                }
+            }
+            if (ControlBytes::matchBytes(group, ControlBytes::CTRL_EMPTY))
+                return -1;
+            g = Probe::next(g, i) & (a.groups - 1);
+        }
+        return -1;
+    }
+
+    // Takes the first free slot on the hash's probe sequence by setting its
+    // control byte to the fingerprint; -1 if every slot is taken.
+    static int claimSlot(Array &a, uint64_t h, bool &wasEmpty)
+    {
+        int8_t fp = ControlBytes::fingerprint(h);
+        int8_t group[GROUP];
+        int g = homeGroup(a, h);
+        for (int i = 1; i <= a.groups; i++)
+        {
+            a.loadGroup(g, group);
+            for (uint32_t m = ControlBytes::freeBytes(group); m; m &= m - 1)
+            {
+                int s = g * GROUP + ControlBytes::lowestBit(m);
+                bool claimed = a.editCtrl(s, [&](int8_t &c)
+                                          {
+                    if (c >= 0)
+                        return false; // another stripe was first
+                    wasEmpty = c == ControlBytes::CTRL_EMPTY;
+                    c = fp;
+                    return true; });
+                if (claimed)
+                    return s;
+            }
+            g = Probe::next(g, i) & (a.groups - 1);
+        }
+        return -1;
+    }
+
+    // Stores a key that is not in 'a'; its stripe is locked. False if every
+    // slot is taken.
+    bool claim(Array &a, Entry *entry)
+    {
+        bool wasEmpty = false;
+        int s = claimSlot(a, entry->hash, wasEmpty);
+        if (s == -1)
+            return false;
+        if (wasEmpty)
+            used++;
+        a.slots[s].store(entry);
+        count++;
+        return true;
+    }
+
+    void retire(Entry *e)
+    {
+        EpochDomain::instance().retire([e]()
+                                       { delete e; });
+    }
+
+    // Replaces 'seen' by a fresh array (doubled if it is really that full,
+    // otherwise the same size without DELETED slots), unless another writer
+    // already did. Takes every stripe, so no writer is inside the table.
+    // Time complexity O(n)
+    void grow(Array *seen)
+    {
+        for (mutex &m : stripes)
+            m.lock();
+        Array *old = array.load();
+        if (old == seen)
+        {
+            int n = old->slotCount;
+            Array *next = new Array(count + 1 > maxLoad * n / 2 ? n * 2 : n);
+            for (int s = 0; s < n; s++)
+            {
+                Entry *e = old->slots[s].load();
+                bool wasEmpty;
+                if (e)
+                    next->slots[claimSlot(*next, e->hash, wasEmpty)].store(e, memory_order_relaxed);
             }
+            used = count.load();
+            array.store(next);
+            EpochDomain::instance().retire([old]()
+                                           { delete old; });
         }
-        return false;
+        for (mutex &m : stripes)
+            m.unlock();
+    }
+
+    // The key's entry is replaced by make(old entry or nullptr), which
+    // returns the new entry or nullptr to leave it alone. Returns whether
+    // the key was new.
+    template <class K, class Make>
+    bool write(const K &key, Make make)
+    {
+        uint64_t h = hasher(key);
+        EpochGuard pin; // the array may be replaced and retired meanwhile
+        while (true)
+        {
+            Array *a = array.load();
+            if (used + 1 > maxLoad * a->slotCount)
+            {
+                grow(a);
+                continue;
+            }
+            unique_lock<mutex> guard(stripeOf(stripes, h));
+            if (a != array.load())
+                continue; // grown meanwhile
+            Entry *old = nullptr;
+            int s = locate(*a, key, h, old);
+            Entry *next = make(old);
+            if (s != -1)
+            {
+                if (next)
+                {
+                    a->slots[s].store(next);
+                    retire(old);
+                }
+                return false;
+            }
+            if (!next || claim(*a, next))
+                return true;
+            // Full: other stripes claimed the last slots since the check
+            delete next;
+            guard.unlock();
+            grow(a);
+        }
+    }
+
+public:
+    explicit ConcurrentTable(int initialSize = 97, double loadFactor = DEFAULT_MAX_LOAD)
+        : array(new Array(tableSizeFor(initialSize))), maxLoad(loadFactor)
+    {
+    }
+
+    // No reader or writer may be left
+    ~ConcurrentTable()
+    {
+        Array *a = array.load();
+        for (int s = 0; s < a->slotCount; s++)
+            delete a->slots[s].load();
+        delete a;
+    }
+
+    ConcurrentTable(const ConcurrentTable &) = delete;
+    ConcurrentTable &operator=(const ConcurrentTable &) = delete;
+
+    int size() const { return count; }
+
+    int capacity() const
+    {
+        EpochGuard pin;
+        return array.load()->slotCount;
+    }
+
+    // Calls f(value) while the entry is pinned; false if the key is absent.
+    // Lock-free, O(1) on average
+    template <class K, class F>
+    bool read(const K &key, F f) const
+    {
+        EpochGuard pin;
+        Entry *e = nullptr;
+        if (locate(*array.load(), key, hasher(key), e) == -1)
+            return false;
+        f(static_cast<const Value &>(e->value));
+        return true;
+    }
+
+    // Copies the value out; false (and 'out' untouched) if the key is absent
+    template <class K>
+    bool find(const K &key, Value &out) const
+    {
+        return read(key, [&](const Value &v)
+                    { out = v; });
+    }
+
+    // Adds the key or replaces its value; true if the key was new.
+    // Time complexity O(1) amortized
+    bool insert(const Key &key, Value value)
+    {
+        uint64_t h = hasher(key);
+        return write(key, [&](Entry *)
+                     { return new Entry{h, key, value}; });
+    }
+
+    // f(value, isNew) edits a copy of the key's value (a default Value for
+    // a new key) that then replaces it; true if the key was new.
+    template <class F>
+    bool upsert(const Key &key, F f)
+    {
+        uint64_t h = hasher(key);
+        return write(key, [&](Entry *old)
+                     {
+            Entry *next = old ? new Entry(*old) : new Entry{h, key, Value()};
+            f(next->value, old == nullptr);
+            return next; });
+    }
+
+    // Like upsert for an existing key only; false if the key is absent
+    template <class K, class F>
+    bool update(const K &key, F f)
+    {
+        bool found = false;
+        write(key, [&](Entry *old) -> Entry *
+              {
+            if (!old)
+                return nullptr;
+            found = true;
+            Entry *next = new Entry(*old);
+            f(next->value);
+            return next; });
+        return found;
+    }
+
+    // Time complexity O(1) on average
+    template <class K>
+    bool erase(const K &key)
+    {
+        uint64_t h = hasher(key);
+        lock_guard<mutex> guard(stripeOf(stripes, h));
+        Array *a = array.load(); // stable while a stripe is held
+        Entry *old = nullptr;
+        int s = locate(*a, key, h, old);
+        if (s == -1)
+            return false;
+        // Pointer first: once the byte is DELETED, another stripe may claim
+        // the slot and store its own entry
+        a->slots[s].store(nullptr);
+        a->editCtrl(s, [](int8_t &c)
+                    {
+            c = ControlBytes::CTRL_DELETED;
+            return true; });
+        count--;
+        retire(old);
+        return true;
+    }
+
+    // f(key, value) for every entry, in slot order; entries written during
+    // the walk may or may not be seen. Time complexity O(capacity)
+    template <class F>
+    void forEach(F f) const
+    {
+        EpochGuard pin;
+        const Array *a = array.load();
+        for (int s = 0; s < a->slotCount; s++)
+        {
+            Entry *e = a->slots[s].load();
+            if (e)
+                f(static_cast<const Key &>(e->key), static_cast<const Value &>(e->value));
+        }
+    }
+};
+
+enum Status
+{
+    EMPTY,
+    OCCUPIED,
+    DELETED
+};
+
+// Roads are undirected, so a route is keyed by the ids (City::point) of its
+// two cities in canonical order: the smaller id in the high 32 bits, the
+// larger one in the low 32 bits. "A-B" and "B-A" are the same key, and the
+// cities come back out of it without parsing names. The "A-B" text form is
+// only read at the API boundary (SimpleHash::routeKeyOf).
+typedef uint64_t RouteKey;
+
+const RouteKey NO_ROUTE = ~0ULL; // no such road (unknown or identical cities)
+
+inline RouteKey makeRouteKey(int a, int b)
+{
+    if (a > b)
+        swap(a, b);
+    return ((uint64_t)(uint32_t)a << 32) | (uint32_t)b;
+}
+
+inline int routeLow(RouteKey key) { return (int)(key >> 32); }
+inline int routeHigh(RouteKey key) { return (int)(uint32_t)key; }
+
+struct RouteEntry
+{
+    RouteKey key;
+    int distance;
+    bool isBlocked;
+    Status status;
+    int capacity = 0; // packages per shift in each direction, 0 = unlimited
+};
+
+class hashroutes
+{
+private:
+    ConcurrentTable<RouteKey, RouteEntry, IntHash> table;
+
+public:
+    hashroutes(int initialSize = 97, double loadFactor = DEFAULT_MAX_LOAD)
+        : table(initialSize, loadFactor)
+    {
+    }
+
+    int routeCount() const { return table.size(); }
+    int capacity() const { return table.capacity(); }
+
+    // Insertion of the routes, grows the table when needed. An existing
+    // road (in either direction) gets the new distance and block state.
+    // Time complexity O(1) amortized
+    // SPACE COMPLEXITY O(1)
+    bool insert(RouteKey key, int distance, bool isBlocked = false)
+    {
+        if (key == NO_ROUTE)
+            return false;
+        table.upsert(key, [&](RouteEntry &entry, bool isNew)
+                     {
+            if (isNew)
+                entry = {key, distance, isBlocked, OCCUPIED};
+            entry.distance = distance;
+            entry.isBlocked = isBlocked; });
+        return true;
+    }
+
+    // Time complexity O(1)
+    bool remove(RouteKey key) { return table.erase(key); }
+
+    bool blockRoute(RouteKey key) { return updateBlockStatus(key, true); }
+    bool unblockRoute(RouteKey key) { return updateBlockStatus(key, false); }
+
+    // Updating the status of roads
+    // Complexity is O(1)
+    bool updateBlockStatus(RouteKey key, bool status)
+    {
+        return table.update(key, [&](RouteEntry &entry)
+                            { entry.isBlocked = status; });
+    }
+
+    // Packages the road takes per shift (see Congestion.h), 0 = unlimited
+    // Complexity is O(1)
+    bool setCapacity(RouteKey key, int capacity)
+    {
+        return table.update(key, [&](RouteEntry &entry)
+                            { entry.capacity = capacity; });
+    }
+
+    // Looking up one route, status EMPTY if it does not exist
+    // Time complexity O(1)
+    RouteEntry getRoute(RouteKey key) const
+    {
+        RouteEntry entry = {key, -1, false, EMPTY};
+        table.find(key, entry);
+        return entry;
     }
 
     // Getting the routes data to send to the frontend
@@ -103,11 +869,8 @@ public:
     vector<RouteEntry> getAllRoutes() const
     {
         vector<RouteEntry> activeRoutes;
-        for (const auto &entry : table)
-        {
-            if (entry.status == OCCUPIED)
-                activeRoutes.push_back(entry);
-        }
+        table.forEach([&](RouteKey, const RouteEntry &entry)
+                      { activeRoutes.push_back(entry); });
         return activeRoutes;
     }
 };
@@ -124,112 +887,93 @@ struct City
 class SimpleHash
 {
 private:
-    int size;
-    vector<City> table;
+    ConcurrentTable<string, City> table;
 
 public:
-    SimpleHash(int tableSize = 97) : size(tableSize)
+    SimpleHash(int tableSize = 97, double loadFactor = DEFAULT_MAX_LOAD)
+        : table(tableSize, loadFactor)
     {
-        table.resize(size, {"EMPTY", -1, ""});
     }
 
-    int hashFunction(const string &key) const
+    int cityCount() const { return table.size(); }
+    int capacity() const { return table.capacity(); }
+
+    // 1. UPDATE: Insert now takes x and y (default to 0.0f)
+    // Grows the table when needed. Time complexity O(1) amortized
+    bool insert(const string &key, int value, const string &password, float x = 0.0f, float y = 0.0f)
     {
-        int sum = 0;
-        for (char c : key)
-            sum += c;
-        return sum % size;
+        table.upsert(key, [&](City &city, bool isNew)
+                     {
+            if (isNew)
+                city = {key, value, password, x, y};
+            city.point = value;
+            city.password = password;
+            // Don't overwrite X/Y with 0 if it already exists and input is 0
+            if (x != 0.0f)
+                city.x = x;
+            if (y != 0.0f)
+                city.y = y; });
+        return true;
     }
 
-    // 1. UPDATE: Insert now takes x and y (default to 0.0f)
-    bool insert(string key, int value, string password, float x = 0.0f, float y = 0.0f)
+    // Time complexity O(1)
+    bool remove(string_view key) { return table.erase(key); }
+
+    // 2. NEW: Method to update coordinates specifically
+    void updatePosition(string_view key, float x, float y)
     {
-        int hashIndex = hashFunction(key);
-        int firstDeleted = -1;
+        table.update(key, [&](City &city)
+                     {
+            city.x = x;
+            city.y = y; });
+    }
 
-        for (int i = 0; i < size; i++)
-        {
-            int index = (hashIndex + (i * i)) % size;
-            if (table[index].name == key)
-            {
-                table[index].point = value;
-                table[index].password = password;
-                // Don't overwrite X/Y with 0 if it already exists and input is 0
-                if (x != 0.0f)
-                    table[index].x = x;
-                if (y != 0.0f)
-                    table[index].y = y;
-                return true;
-            }
-            if (table[index].name == "DELETED" && firstDeleted == -1)
-                firstDeleted = index;
-            if (table[index].name == "EMPTY")
-            {
-                if (firstDeleted != -1)
-                    index = firstDeleted;
-                table[index] = {key, value, password, x, y};
-                return true;
-            }
-        }
-        return false;
+    // Lookups take no lock (see ConcurrentTable), e.g. for logins
+    int getPoint(string_view key) const
+    {
+        int point = -1;
+        table.read(key, [&](const City &city)
+                   { point = city.point; });
+        return point;
     }
 
-    // 2. NEW: Method to update coordinates specifically
-    void updatePosition(string key, float x, float y)
+    string getPassword(string_view key) const
     {
-        int hashIndex = hashFunction(key);
-        for (int i = 0; i < size; i++)
-        {
-            int index = (hashIndex + (i * i)) % size;
-            if (table[index].name == "EMPTY")
-                return;
-            if (table[index].name == key)
-            {
-                table[index].x = x;
-                table[index].y = y;
-                return;
-            }
-        }
+        string password = "-1";
+        table.read(key, [&](const City &city)
+                   { password = city.password; });
+        return password;
     }
 
-    int getPoint(string key)
+    // Whole record of one city, point -1 if it does not exist
+    City getCity(string_view key) const
     {
-        int hashIndex = hashFunction(key);
-        for (int i = 0; i < size; i++)
-        {
-            int index = (hashIndex + (i * i)) % size;
-            if (table[index].name == "EMPTY")
-                return -1;
-            if (table[index].name == key)
-                return table[index].point;
-        }
-        return -1;
+        City city = {string(key), -1, "", 0.0f, 0.0f};
+        table.find(key, city);
+        return city;
     }
 
-    string getPassword(string key)
+    // Key of the road named "CityA-CityB" (split at the first '-'), in
+    // either order; NO_ROUTE if a city is unknown or both are the same.
+    // Time complexity O(length)
+    RouteKey routeKeyOf(string_view name) const
     {
-        int hashIndex = hashFunction(key);
-        for (int i = 0; i < size; i++)
-        {
-            int index = (hashIndex + (i * i)) % size;
-            if (table[index].name == "EMPTY")
-                return "-1";
-            if (table[index].name == key)
-                return table[index].password;
-        }
-        return "-1";
+        size_t dash = name.find('-');
+        if (dash == string_view::npos)
+            return NO_ROUTE;
+        int a = getPoint(name.substr(0, dash)), b = getPoint(name.substr(dash + 1));
+        if (a < 0 || b < 0 || a == b)
+            return NO_ROUTE;
+        return makeRouteKey(a, b);
     }
 
-    vector<City> getAll()
+    vector<City> getAll() const
     {
         vector<City> activeData;
-        for (const auto &entry : table)
-        {
-            if (entry.name != "EMPTY" && entry.name != "DELETED")
-                activeData.push_back(entry);
-        }
+        table.forEach([&](const string &, const City &city)
+                      { activeData.push_back(city); });
         return activeData;
     }
 };
 
-#endif
\ No newline at end of file
+#endif
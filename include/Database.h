@@ -5,7 +5,11 @@
 #include <string>
 #include <vector>
 #include <sqlite3.h>
+#include <map>
+#include <set>
+#include <algorithm>
 #include "CustomHash.h"
+#include "TimeDependent.h"
 
 using namespace std;
 
@@ -13,14 +17,19 @@ class SaveRoute
 {
 private:
     sqlite3 *db_ = nullptr;
-    const string tableName_ = "Routes";
 
 public:
     SaveRoute(const std::string &filename)
     {
         sqlite3_open(filename.c_str(), &db_);
-        const char *sql = "CREATE TABLE IF NOT EXISTS Routes (Key TEXT PRIMARY KEY, Distance INT, IsBlocked INT);";
+        // Roads by route key (see makeRouteKey), i.e. by their two city ids
+        const char *sql = "CREATE TABLE IF NOT EXISTS Roads (Road INTEGER PRIMARY KEY, Distance INT, IsBlocked INT, Capacity INT DEFAULT 0);";
         sqlite3_exec(db_, sql, nullptr, nullptr, nullptr);
+
+        // Time-dependent costs (see TimeDependent.h) and the simulation clock
+        sqlite3_exec(db_, "CREATE TABLE IF NOT EXISTS RoadProfiles (Road INT, Minute INT, Factor INT, PRIMARY KEY (Road, Minute));", nullptr, nullptr, nullptr);
+        sqlite3_exec(db_, "CREATE TABLE IF NOT EXISTS RoadClosures (Road INT, StartTime INT, EndTime INT);", nullptr, nullptr, nullptr);
+        sqlite3_exec(db_, "CREATE TABLE IF NOT EXISTS SimClock (ID INTEGER PRIMARY KEY CHECK (ID = 0), Minute INT);", nullptr, nullptr, nullptr);
     }
     ~SaveRoute()
     {
@@ -28,17 +37,118 @@ public:
             sqlite3_close(db_);
     }
 
+    // Moves the rows of databases from before route keys, which named roads
+    // "CityA-CityB" (Routes, RouteProfiles, RouteClosures tables), to the
+    // keyed tables. Both directions of a road become one row: the shorter
+    // distance, blocked only if every copy was, like the parallel roads the
+    // graph used to build from them. Rows naming unknown cities stay behind.
+    // A road that already has a keyed row (e.g. an earlier migration that
+    // stopped half way, or an edit after restoring an old file) keeps it, and
+    // keeps its keyed profile and closures: legacy rows never overwrite them.
+    // Time complexity O(R log R)
+    void migrateNamedRoutes(const SimpleHash &cities)
+    {
+        sqlite3_stmt *stmt;
+        sqlite3_exec(db_, "ALTER TABLE Routes ADD COLUMN Capacity INT DEFAULT 0;", nullptr, nullptr, nullptr);
+        if (sqlite3_prepare_v2(db_, "SELECT Key, Distance, IsBlocked, Capacity FROM Routes;", -1, &stmt, nullptr) != SQLITE_OK)
+            return;
+        map<RouteKey, RouteEntry> roads;
+        vector<string> moved;
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            string name = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
+            RouteKey key = cities.routeKeyOf(name);
+            if (key == NO_ROUTE)
+                continue;
+            RouteEntry r = {key, sqlite3_column_int(stmt, 1), sqlite3_column_int(stmt, 2) != 0, OCCUPIED,
+                            sqlite3_column_int(stmt, 3)};
+            auto it = roads.find(key);
+            if (it != roads.end())
+            {
+                r.distance = min(r.distance, it->second.distance);
+                r.isBlocked = r.isBlocked && it->second.isBlocked;
+                r.capacity = max(r.capacity, it->second.capacity);
+            }
+            roads[key] = r;
+            moved.push_back(name);
+        }
+        sqlite3_finalize(stmt);
+        if (moved.empty())
+            return;
+
+        sqlite3_exec(db_, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+        if (sqlite3_prepare_v2(db_, "INSERT OR IGNORE INTO Roads (Road, Distance, IsBlocked, Capacity) VALUES (?, ?, ?, ?);",
+                               -1, &stmt, nullptr) == SQLITE_OK)
+        {
+            for (const auto &r : roads)
+            {
+                sqlite3_bind_int64(stmt, 1, (sqlite3_int64)r.first);
+                sqlite3_bind_int(stmt, 2, r.second.distance);
+                sqlite3_bind_int(stmt, 3, r.second.isBlocked ? 1 : 0);
+                sqlite3_bind_int(stmt, 4, r.second.capacity);
+                sqlite3_step(stmt);
+                sqlite3_reset(stmt);
+            }
+            sqlite3_finalize(stmt);
+        }
+        // Roads that had a keyed schedule (profile or closures) before this migration
+        set<RouteKey> scheduled;
+        const char *keyed[] = {"SELECT Road FROM RoadProfiles;", "SELECT Road FROM RoadClosures;"};
+        for (const char *sql : keyed)
+        {
+            if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK)
+                continue;
+            while (sqlite3_step(stmt) == SQLITE_ROW)
+                scheduled.insert(sqlite3_column_int64(stmt, 0));
+            sqlite3_finalize(stmt);
+        }
+        const char *copies[] = {
+            "INSERT OR REPLACE INTO RoadProfiles (Road, Minute, Factor) SELECT ?, Minute, Factor FROM RouteProfiles WHERE Key = ?;",
+            "INSERT INTO RoadClosures (Road, StartTime, EndTime) SELECT ?, StartTime, EndTime FROM RouteClosures WHERE Key = ?;"};
+        for (const char *sql : copies)
+        {
+            if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK)
+                continue;
+            for (const string &name : moved)
+            {
+                RouteKey key = cities.routeKeyOf(name);
+                if (scheduled.count(key))
+                    continue;
+                sqlite3_bind_int64(stmt, 1, (sqlite3_int64)key);
+                sqlite3_bind_text(stmt, 2, name.c_str(), -1, SQLITE_STATIC);
+                sqlite3_step(stmt);
+                sqlite3_reset(stmt);
+            }
+            sqlite3_finalize(stmt);
+        }
+        const char *removals[] = {"DELETE FROM RouteProfiles WHERE Key = ?;", "DELETE FROM RouteClosures WHERE Key = ?;",
+                                  "DELETE FROM Routes WHERE Key = ?;"};
+        for (const char *sql : removals)
+        {
+            if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK)
+                continue;
+            for (const string &name : moved)
+            {
+                sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_STATIC);
+                sqlite3_step(stmt);
+                sqlite3_reset(stmt);
+            }
+            sqlite3_finalize(stmt);
+        }
+        sqlite3_exec(db_, "COMMIT;", nullptr, nullptr, nullptr);
+    }
+
     void loadToHashTable(hashroutes &ht)
     {
-        std::string sql = "SELECT Key, Distance, IsBlocked FROM " + tableName_;
+        std::string sql = "SELECT Road, Distance, IsBlocked, Capacity FROM Roads";
         sqlite3_stmt *stmt;
         if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
             return;
         while (sqlite3_step(stmt) == SQLITE_ROW)
         {
-            ht.insert(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0)),
-                      sqlite3_column_int(stmt, 1),
-                      sqlite3_column_int(stmt, 2) != 0);
+            RouteKey key = sqlite3_column_int64(stmt, 0);
+            ht.insert(key, sqlite3_column_int(stmt, 1), sqlite3_column_int(stmt, 2) != 0);
+            ht.setCapacity(key, sqlite3_column_int(stmt, 3));
         }
         sqlite3_finalize(stmt);
     }
@@ -46,20 +156,109 @@ public:
     void saveFromHashTable(hashroutes &ht)
     {
         sqlite3_exec(db_, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
-        std::string sql = "INSERT OR REPLACE INTO " + tableName_ + " (Key, Distance, IsBlocked) VALUES (?, ?, ?);";
-        sqlite3_stmt *stmt;
-        sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr);
         for (const auto &entry : ht.getAllRoutes())
+            saveRoute(entry);
+        sqlite3_exec(db_, "COMMIT;", nullptr, nullptr, nullptr);
+    }
+
+    // Writes a single route (one added / edited road) instead of the whole table
+    void saveRoute(const RouteEntry &entry)
+    {
+        std::string sql = "INSERT OR REPLACE INTO Roads (Road, Distance, IsBlocked, Capacity) VALUES (?, ?, ?, ?);";
+        sqlite3_stmt *stmt;
+        if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+            return;
+        sqlite3_bind_int64(stmt, 1, (sqlite3_int64)entry.key);
+        sqlite3_bind_int(stmt, 2, entry.distance);
+        sqlite3_bind_int(stmt, 3, entry.isBlocked ? 1 : 0);
+        sqlite3_bind_int(stmt, 4, entry.capacity);
+        sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+    }
+
+    // Profiles and closure windows by route key
+    map<RouteKey, TravelSchedule> loadSchedules()
+    {
+        map<RouteKey, TravelSchedule> schedules;
+        sqlite3_stmt *stmt;
+        if (sqlite3_prepare_v2(db_, "SELECT Road, Minute, Factor FROM RoadProfiles;", -1, &stmt, nullptr) == SQLITE_OK)
+        {
+            while (sqlite3_step(stmt) == SQLITE_ROW)
+                schedules[sqlite3_column_int64(stmt, 0)].profile.push_back(
+                    {sqlite3_column_int(stmt, 1), sqlite3_column_int(stmt, 2)});
+            sqlite3_finalize(stmt);
+        }
+        if (sqlite3_prepare_v2(db_, "SELECT Road, StartTime, EndTime FROM RoadClosures;", -1, &stmt, nullptr) == SQLITE_OK)
         {
-            sqlite3_bind_text(stmt, 1, entry.key.c_str(), -1, SQLITE_STATIC);
-            sqlite3_bind_int(stmt, 2, entry.distance);
-            sqlite3_bind_int(stmt, 3, entry.isBlocked ? 1 : 0);
+            while (sqlite3_step(stmt) == SQLITE_ROW)
+                schedules[sqlite3_column_int64(stmt, 0)].closures.push_back(
+                    {sqlite3_column_int64(stmt, 1), sqlite3_column_int64(stmt, 2)});
+            sqlite3_finalize(stmt);
+        }
+        for (auto &s : schedules)
+            s.second.normalize();
+        return schedules;
+    }
+
+    // Replaces the profile and closures of one route
+    void saveSchedule(RouteKey key, const TravelSchedule &schedule)
+    {
+        sqlite3_exec(db_, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+        sqlite3_stmt *stmt;
+        const char *removals[] = {"DELETE FROM RoadProfiles WHERE Road = ?;", "DELETE FROM RoadClosures WHERE Road = ?;"};
+        for (const char *sql : removals)
+        {
+            sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
+            sqlite3_bind_int64(stmt, 1, (sqlite3_int64)key);
+            sqlite3_step(stmt);
+            sqlite3_finalize(stmt);
+        }
+
+        sqlite3_prepare_v2(db_, "INSERT OR REPLACE INTO RoadProfiles (Road, Minute, Factor) VALUES (?, ?, ?);", -1, &stmt, nullptr);
+        for (const auto &p : schedule.profile)
+        {
+            sqlite3_bind_int64(stmt, 1, (sqlite3_int64)key);
+            sqlite3_bind_int(stmt, 2, p.first);
+            sqlite3_bind_int(stmt, 3, p.second);
+            sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+        }
+        sqlite3_finalize(stmt);
+
+        sqlite3_prepare_v2(db_, "INSERT INTO RoadClosures (Road, StartTime, EndTime) VALUES (?, ?, ?);", -1, &stmt, nullptr);
+        for (const auto &c : schedule.closures)
+        {
+            sqlite3_bind_int64(stmt, 1, (sqlite3_int64)key);
+            sqlite3_bind_int64(stmt, 2, c.first);
+            sqlite3_bind_int64(stmt, 3, c.second);
             sqlite3_step(stmt);
             sqlite3_reset(stmt);
         }
         sqlite3_finalize(stmt);
         sqlite3_exec(db_, "COMMIT;", nullptr, nullptr, nullptr);
     }
+
+    long long loadClock()
+    {
+        long long minute = 0;
+        sqlite3_stmt *stmt;
+        if (sqlite3_prepare_v2(db_, "SELECT Minute FROM SimClock WHERE ID = 0;", -1, &stmt, nullptr) != SQLITE_OK)
+            return minute;
+        if (sqlite3_step(stmt) == SQLITE_ROW)
+            minute = sqlite3_column_int64(stmt, 0);
+        sqlite3_finalize(stmt);
+        return minute;
+    }
+
+    void saveClock(long long minute)
+    {
+        sqlite3_stmt *stmt;
+        if (sqlite3_prepare_v2(db_, "INSERT OR REPLACE INTO SimClock (ID, Minute) VALUES (0, ?);", -1, &stmt, nullptr) != SQLITE_OK)
+            return;
+        sqlite3_bind_int64(stmt, 1, minute);
+        sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+    }
 };
 
 class CityDatabase
@@ -122,6 +321,22 @@ public:
         sqlite3_finalize(stmt);
         sqlite3_exec(db_, "COMMIT;", nullptr, nullptr, nullptr);
     }
+
+    // Writes a single city (new city or moved node) instead of the whole table
+    void saveCity(const City &entry)
+    {
+        std::string sql = "INSERT OR REPLACE INTO " + tableName_ + " (Name, Value, Password, X, Y) VALUES (?, ?, ?, ?, ?);";
+        sqlite3_stmt *stmt;
+        if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+            return;
+        sqlite3_bind_text(stmt, 1, entry.name.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 2, entry.point);
+        sqlite3_bind_text(stmt, 3, entry.password.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_double(stmt, 4, entry.x);
+        sqlite3_bind_double(stmt, 5, entry.y);
+        sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+    }
 };
 
 // [In FastGo/include/Database.h, insert before #endif]
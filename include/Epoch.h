@@ -0,0 +1,154 @@
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <algorithm>
+
+using namespace std;
+
+// Epoch-based reclamation for the lock-free readers of ConcurrentTable
+// (CustomHash.h). A reader pins the current epoch while it looks at shared
+// memory; a writer that unlinks an object retires it with the epoch it was
+// unlinked in, and the object is freed once every pinned reader started in
+// a later epoch, i.e. after it was already unreachable.
+//
+// One domain for the process; every thread that reads takes one of its
+// records on first use and gives it back when it exits.
+class EpochDomain
+{
+public:
+    static constexpr int MAX_THREADS = 256;
+
+private:
+    static constexpr uint64_t IDLE = ~0ULL;
+
+    // Epoch the thread pinned, IDLE if it is not reading. A cache line each,
+    // so readers on different cores do not share one.
+    struct alignas(64) Record
+    {
+        atomic<uint64_t> epoch{IDLE};
+        atomic<bool> owned{false};
+    };
+
+    struct Retired
+    {
+        uint64_t epoch;
+        function<void()> destroy;
+    };
+
+    // This thread's record; depth counts nested pins
+    struct ThreadRecord
+    {
+        Record *record = nullptr;
+        int depth = 0;
+        ~ThreadRecord()
+        {
+            if (record)
+                record->owned.store(false);
+        }
+    };
+
+    Record records[MAX_THREADS];
+    atomic<uint64_t> global{1};
+    mutex retireLock;
+    vector<Retired> retired;
+
+    // Waits for a free record if all of them are taken
+    Record *claim()
+    {
+        while (true)
+        {
+            for (Record &r : records)
+            {
+                bool expected = false;
+                if (!r.owned.load(memory_order_relaxed) && r.owned.compare_exchange_strong(expected, true))
+                    return &r;
+            }
+            this_thread::yield();
+        }
+    }
+
+    ThreadRecord &local()
+    {
+        thread_local ThreadRecord self;
+        if (!self.record)
+            self.record = claim();
+        return self;
+    }
+
+    // Frees what no pinned reader can still see. retireLock must be held.
+    // Time complexity O(MAX_THREADS + retired)
+    void reclaim()
+    {
+        uint64_t oldest = IDLE;
+        for (Record &r : records)
+            oldest = min(oldest, r.epoch.load());
+        size_t kept = 0;
+        for (size_t i = 0; i < retired.size(); i++)
+        {
+            if (retired[i].epoch < oldest)
+                retired[i].destroy();
+            else
+                retired[kept++] = move(retired[i]);
+        }
+        retired.resize(kept);
+    }
+
+public:
+    static EpochDomain &instance()
+    {
+        static EpochDomain domain;
+        return domain;
+    }
+
+    ~EpochDomain()
+    {
+        for (Retired &r : retired)
+            r.destroy();
+    }
+
+    // The record, the writers' unlinking stores, the epoch counter and the
+    // readers' pointer loads are all sequentially consistent, so a writer
+    // either sees the record when it reclaims or the reader sees the
+    // unlinked state.
+    void enter()
+    {
+        ThreadRecord &self = local();
+        if (self.depth++ == 0)
+            self.record->epoch.store(global.load());
+    }
+
+    void leave()
+    {
+        ThreadRecord &self = local();
+        if (--self.depth == 0)
+            self.record->epoch.store(IDLE, memory_order_release);
+    }
+
+    // Frees the object once the readers pinned up to now are gone. The
+    // caller has already unlinked it.
+    void retire(function<void()> destroy)
+    {
+        uint64_t epoch = global.fetch_add(1);
+        lock_guard<mutex> guard(retireLock);
+        retired.push_back({epoch, move(destroy)});
+        reclaim();
+    }
+};
+
+// Pins the epoch for the guard's scope
+class EpochGuard
+{
+public:
+    EpochGuard() { EpochDomain::instance().enter(); }
+    ~EpochGuard() { EpochDomain::instance().leave(); }
+    EpochGuard(const EpochGuard &) = delete;
+    EpochGuard &operator=(const EpochGuard &) = delete;
+};
+
+#endif
@@ -37,6 +37,17 @@ private:
     RiderDatabase riderDB; // Add this member
     string currentRiderUser;
 
+    // Simulation clock (minutes) and road schedules, both kept in routes.db
+    static constexpr int SHIFT_MINUTES = 60;
+    long long simClock = 0;
+    map<RouteKey, TravelSchedule> routeSchedules;
+
+    // Worker threads for the routing phase of runTimeStep
+    WorkStealingPool routingPool;
+    // One shift at a time: overlapping /api/next_shift requests would move
+    // the same packages twice and race on the clock
+    mutex shiftLock;
+
     // --- Helper: Get Current Time as String ---
     string getCurrentTime()
     {
@@ -49,25 +60,37 @@ private:
         return string(buffer);
     }
 
-    // --- Helper: Convert Vector to Comma-Separated String ---
-    // Used to store the "Future Route" list in the database
-    string vecToString(const vector<string> &vec)
+    // --- Helper: Does a stored route plan (city ids) drive over road a-b? ---
+    bool planUsesRoad(const vector<int> &plan, int a, int b)
+    {
+        for (size_t i = 1; i < plan.size(); i++)
+            if ((plan[i - 1] == a && plan[i] == b) || (plan[i - 1] == b && plan[i] == a))
+                return true;
+        return false;
+    }
+
+    // Same for a legacy text plan ("A,B,C")
+    bool planUsesRoad(const string &plan, const string &a, const string &b)
     {
-        stringstream ss;
-        for (size_t i = 0; i < vec.size(); ++i)
+        stringstream ss(plan);
+        string prev, city;
+        while (getline(ss, city, ','))
         {
-            ss << vec[i];
-            if (i != vec.size() - 1)
-                ss << ",";
+            if ((prev == a && city == b) || (prev == b && city == a))
+                return true;
+            prev = city;
         }
-        return ss.str();
+        return false;
     }
 
 public:
     FastGo() : currentRole(Guest), cityDB("cities.db"), routeDB("routes.db"), pkgDB("packages.db")
     {
         cityDB.loadToSimpleHash(cityHashTable);
+        routeDB.migrateNamedRoutes(cityHashTable);
         routeDB.loadToHashTable(routeHashTable);
+        routeSchedules = routeDB.loadSchedules();
+        simClock = routeDB.loadClock();
     }
 
     // --- Authentication ---
@@ -154,11 +177,7 @@ public:
 
         p.historyStr = currentUserCity + "|" + getCurrentTime();
 
-        auto res = graph.getShortestPath(currentUserCity, dest);
-        if (res.first != -1)
-            p.routeStr = vecToString(res.second);
-        else
-            p.routeStr = "";
+        p.route = graph.getRoute(currentUserCity, dest).second; // empty if unreachable
 
         pkgDB.addPackage(p);
     }
@@ -173,11 +192,11 @@ public:
             if (status == RETURNED)
             {
                 string newHist = p.historyStr + ",RETURNED TO SENDER|" + getCurrentTime();
-                pkgDB.updateStatusAndRoute(id, 8, p.currentCity, newHist, "");
+                pkgDB.updateStatusAndRoute(id, 8, p.currentCity, newHist, {});
             }
             else
             {
-                pkgDB.updateStatusAndRoute(id, status, p.currentCity, p.historyStr, p.routeStr);
+                pkgDB.updateStatus(id, status);
             }
         }
     }
@@ -211,37 +230,109 @@ public:
         return stats;
     }
 
+    // --- Bulk dispatch ---
+    // Plans the routes of all queued (CREATED / LOADED) packages together
+    // under the road capacities, overnight packages first, and stores them
+    // in one transaction. ids[i] is the package of plan.routes[i].
+    string planDispatch(const GraphSnapshot &snapshot, vector<int> &ids, DispatchPlan &plan)
+    {
+        if (currentRole != Admin)
+            return "Error: Access Denied";
+        vector<Package> queued;
+        for (const Package &p : pkgDB.getAllPackages())
+            if (p.status == CREATED || p.status == LOADED)
+                queued.push_back(p);
+        stable_sort(queued.begin(), queued.end(), [](const Package &a, const Package &b)
+                    { return a.type < b.type; });
+
+        vector<pair<string, string>> trips;
+        ids.clear();
+        for (const Package &p : queued)
+        {
+            trips.push_back({p.currentCity, p.destCity});
+            ids.push_back(p.id);
+        }
+        plan = snapshot.planDispatch(trips);
+
+        vector<pair<int, vector<int>>> routes;
+        for (size_t i = 0; i < ids.size(); i++)
+        {
+            if (plan.routes[i].empty())
+                continue;
+            vector<int> cityIds;
+            for (int v : plan.routes[i])
+                cityIds.push_back(snapshot.getNodes()[v].id);
+            routes.push_back({ids[i], cityIds});
+        }
+        if (!pkgDB.updateRoutes(routes))
+            return "Error: Could Not Save Plan";
+        return "Success: " + to_string(routes.size()) + " of " + to_string(ids.size()) + " Packages Planned";
+    }
+
     // --- THE CORE SIMULATION LOOP ---
     // Moves packages, updates history, and recalculates future routes
     vector<string> runTimeStep(Graph &graph)
     {
+        lock_guard<mutex> shift(shiftLock);
         vector<string> logs;
         vector<Package> packages = pkgDB.getAllPackages();
-
-        for (auto &p : packages)
+        // The whole shift routes on one version of the map, even if a road
+        // is blocked while it runs.
+        shared_ptr<const GraphSnapshot> snapshot = graph.pin();
+
+        // Routing phase: the next hop of every package that moves this shift,
+        // one tree per destination, spread over the cores. The moves below are
+        // then applied in package order, exactly as a serial shift would.
+        vector<char> moves(packages.size(), 0);
+        vector<pair<string, string>> trips;
+        for (size_t i = 0; i < packages.size(); i++)
         {
+            Package &p = packages[i];
             // Only move packages that are physically moving
             if (p.status != LOADED && p.status != IN_TRANSIT)
                 continue;
 
             // 1. Check Priority Speed (Ticks)
             p.ticks++;
-            bool shouldMove = false;
             // Overnight = Move every tick (Fastest)
             // 2-Day = Move every 2 ticks
             // Normal = Move every 3 ticks
             if (p.type == OVERNIGHT && p.ticks >= 1)
-                shouldMove = true;
+                moves[i] = 1;
             else if (p.type == TWODAY && p.ticks >= 2)
-                shouldMove = true;
+                moves[i] = 1;
             else if (p.type == NORMAL && p.ticks >= 3)
-                shouldMove = true;
+                moves[i] = 1;
+            if (moves[i])
+                trips.push_back({p.currentCity, p.destCity});
+        }
+        // The trees are held until the end of the shift for the routes below
+        vector<shared_ptr<const ShortestPathTree>> trees;
+        vector<string> hops = snapshot->getNextHops(trips, routingPool, &trees);
+
+        // Roads with a capacity: packages are sent one by one in package
+        // order, each one seeing the load the earlier ones put on the roads
+        // (the trees above are reused). Time-dependent routing takes precedence.
+        unique_ptr<RoadLoads> loads;
+        if (snapshot->hasCapacities() && !snapshot->isTimeDependent())
+            loads = make_unique<RoadLoads>(snapshot->getCSR(), snapshot->getCapacities());
+
+        size_t trip = 0;
+        for (size_t i = 0; i < packages.size(); i++)
+        {
+            Package &p = packages[i];
+            if (p.status != LOADED && p.status != IN_TRANSIT)
+                continue;
 
-            if (shouldMove)
+            if (moves[i])
             {
                 // Determine Next Step dynamically
-                // We ask the graph for the best "Next Hop" based on current blocked roads
-                string nextCity = graph.getNextHop(p.currentCity, p.destCity);
+                // The graph gave the best "Next Hop" based on current blocked roads
+                const ShortestPathTree *tree = trees[trip].get();
+                string nextCity = hops[trip];
+                if (loads)
+                    nextCity = snapshot->getCongestedHop(p.currentCity, p.destCity, *loads, trees[trip]);
+                trip++;
 
                 // Reset ticks for next movement cycle
                 pkgDB.updateTicks(p.id, 0);
@@ -257,7 +348,7 @@ public:
                     if (p.currentCity == p.destCity)
                     {
                         string newHist = p.historyStr + "," + nextCity + "|" + getCurrentTime();
-                        pkgDB.updateStatusAndRoute(p.id, ARRIVED, nextCity, newHist, ""); // Clear future route
+                        pkgDB.updateStatusAndRoute(p.id, ARRIVED, nextCity, newHist, {}); // Clear future route
                         logs.push_back("Pkg #" + to_string(p.id) + " ARRIVED at destination " + nextCity);
                     }
                 }
@@ -274,15 +365,11 @@ public:
 
                     // 3. Recalculate Future Route (Blue Line)
                     // Now that we are at 'nextCity', what is the path to 'destCity'?
-                    string newRoute = "";
+                    // Kept as city ids; names are only looked up when a package is tracked.
+                    // The destination's tree was built in the routing phase.
+                    vector<int> newRoute;
                     if (newStatus != ARRIVED)
-                    {
-                        auto res = graph.getShortestPath(nextCity, p.destCity);
-                        if (res.first != -1)
-                        {
-                            newRoute = vecToString(res.second);
-                        }
-                    }
+                        newRoute = snapshot->getTreeRoute(nextCity, p.destCity, tree).second;
 
                     // 4. Save Changes to DB
                     pkgDB.updateStatusAndRoute(p.id, newStatus, nextCity, newHist, newRoute);
@@ -297,6 +384,11 @@ public:
                 pkgDB.updateTicks(p.id, p.ticks);
             }
         }
+
+        // One shift passes on the simulation clock
+        simClock += SHIFT_MINUTES;
+        routeDB.saveClock(simClock);
+        graph.setClock(simClock);
         return logs;
     }
 
@@ -336,49 +428,134 @@ public:
     void updateCityPosition(string name, float x, float y)
     {
         cityHashTable.updatePosition(name, x, y);
-        cityDB.saveFromSimpleHash(cityHashTable);
+        cityDB.saveCity(cityHashTable.getCity(name));
     }
 
     string addCity(string cityName, string cityPassword)
     {
         if (currentRole != Admin)
             return "Error: Access Denied";
-        int newPointId = cityHashTable.getAll().size();
+        int newPointId = cityHashTable.cityCount();
         if (cityHashTable.getPoint(cityName) != -1)
             return "Error: City Exists";
 
         if (cityHashTable.insert(cityName, newPointId, cityPassword))
         {
-            cityDB.saveFromSimpleHash(cityHashTable);
+            cityDB.saveCity(cityHashTable.getCity(cityName));
             return "Success: City Added";
         }
         return "Error: Hash Full";
     }
 
-    string addRoute(string routeKey, int distance)
+    // Key of a road named "CityA-CityB" by the API, NO_ROUTE if it cannot exist
+    RouteKey routeKeyOf(const string &name) { return cityHashTable.routeKeyOf(name); }
+
+    string addRoute(RouteKey routeKey, int distance)
     {
         if (currentRole != Admin)
             return "Error: Access Denied";
+        if (routeKey == NO_ROUTE)
+            return "Error: Unknown City";
+        // The bucket queues, the hierarchy and the A* bounds need weights >= 0
+        if (distance < 0)
+            return "Error: Invalid Distance";
         if (routeHashTable.insert(routeKey, distance, false))
         {
-            routeDB.saveFromHashTable(routeHashTable);
+            routeDB.saveRoute(routeHashTable.getRoute(routeKey));
             return "Success: Route Added";
         }
         return "Error: Failed to Add";
     }
 
-    string toggleRouteBlock(string routeKey, bool block)
+    string toggleRouteBlock(RouteKey routeKey, bool block)
     {
         if (currentRole != Admin)
             return "Error: Access Denied";
         if (block ? routeHashTable.blockRoute(routeKey) : routeHashTable.unblockRoute(routeKey))
         {
-            routeDB.saveFromHashTable(routeHashTable);
+            routeDB.saveRoute(routeHashTable.getRoute(routeKey));
             return block ? "Success: Blocked" : "Success: Unblocked";
         }
         return "Error: Route Not Found";
     }
 
+    // Re-plans only the packages whose route is affected by a single road change
+    // (see Graph::updateRoute). A stored plan that drives over a road that got
+    // blocked or longer is always re-planned: dispatch plans and cached
+    // alternatives need not follow the trees. Otherwise, for destinations with
+    // a cached tree the graph reports exactly which cities got a new route; for
+    // the others we fall back to checking whether the stored plan drives over
+    // the road, or whether the package had no route at all.
+    // Returns the number of packages that got a new route plan.
+    int replanAfterRoadChange(Graph &graph, const RouteUpdate &update)
+    {
+        if (!update.found)
+            return 0;
+        int replanned = 0;
+        int idA = cityHashTable.getPoint(update.cityA), idB = cityHashTable.getPoint(update.cityB);
+        for (const auto &p : pkgDB.getAllPackages())
+        {
+            if (p.status != CREATED && p.status != LOADED && p.status != IN_TRANSIT)
+                continue;
+            bool overRoad = !p.route.empty() ? planUsesRoad(p.route, idA, idB)
+                                             : !p.routeStr.empty() && planUsesRoad(p.routeStr, update.cityA, update.cityB);
+            bool replan;
+            if (update.costRose && overRoad)
+                replan = true;
+            else if (update.cachedDestinations.count(p.destCity))
+                replan = update.affects(p.currentCity, p.destCity);
+            else
+                // Packages without a plan (destination was cut off) are always
+                // re-checked; while still unreachable that is an O(1) lookup.
+                replan = overRoad || (p.route.empty() && p.routeStr.empty());
+            if (!replan)
+                continue;
+
+            vector<int> newRoute = graph.getRoute(p.currentCity, p.destCity).second;
+            if (newRoute == p.route && p.routeStr.empty())
+                continue;
+            pkgDB.updateStatusAndRoute(p.id, p.status, p.currentCity, p.historyStr, newRoute);
+            replanned++;
+        }
+        return replanned;
+    }
+
+    // Profile points are (minute of the day, % of the distance), closures are
+    // [from, to) on the simulation clock. An empty schedule removes it.
+    string setRouteSchedule(RouteKey routeKey, TravelSchedule schedule)
+    {
+        if (currentRole != Admin)
+            return "Error: Access Denied";
+        if (routeHashTable.getRoute(routeKey).status != OCCUPIED)
+            return "Error: Route Not Found";
+        for (const auto &p : schedule.profile)
+            if (p.first < 0 || p.first >= MINUTES_PER_DAY || p.second <= 0)
+                return "Error: Invalid Profile";
+        schedule.normalize();
+        routeDB.saveSchedule(routeKey, schedule);
+        if (schedule.empty())
+            routeSchedules.erase(routeKey);
+        else
+            routeSchedules[routeKey] = schedule;
+        return "Success: Schedule Saved";
+    }
+
+    // Packages per shift the road takes in each direction, 0 = unlimited
+    string setRouteCapacity(RouteKey routeKey, int capacity)
+    {
+        if (currentRole != Admin)
+            return "Error: Access Denied";
+        if (capacity < 0)
+            return "Error: Invalid Capacity";
+        if (!routeHashTable.setCapacity(routeKey, capacity))
+            return "Error: Route Not Found";
+        routeDB.saveRoute(routeHashTable.getRoute(routeKey));
+        return "Success: Capacity Saved";
+    }
+
+    const map<RouteKey, TravelSchedule> &getSchedules() { return routeSchedules; }
+    long long getClock() { return simClock; }
+
     Role getRole() { return currentRole; }
     SimpleHash &getCities() { return cityHashTable; }
     hashroutes &getRoutes() { return routeHashTable; }
@@ -439,7 +616,7 @@ public:
             // FIX: Use ',' to start a NEW history entry.
             // Was: p.historyStr + "|DELIVERED..." which merged it into the previous city.
             string newHist = p.historyStr + ",DELIVERED|" + getCurrentTime();
-            pkgDB.updateStatusAndRoute(pkgId, DELIVERED, p.currentCity, newHist, "");
+            pkgDB.updateStatusAndRoute(pkgId, DELIVERED, p.currentCity, newHist, {});
             return "Delivered";
         }
         else if (action == "failed")
@@ -0,0 +1,260 @@
+#ifndef HUB_LABELS_H
+#define HUB_LABELS_H
+
+#include <vector>
+#include <queue>
+#include <limits>
+#include <algorithm>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+// Hub labeling (2-hop labels) distance oracle, built by pruned landmark
+// labeling. Every node v gets a label: a list of (hub, distance) pairs such
+// that for any s, t some hub on a shortest s-t path is in both labels, so
+//
+//     dist(s, t) = min over common hubs h of dist(s, h) + dist(h, t)
+//
+// is a merge of two sorted lists. One pruned Dijkstra runs from each hub in
+// order of importance; it stops at nodes the labels found so far already
+// answer. How small the labels get depends on that order: degree works for
+// hub-and-spoke networks, while on road grids the reverse contraction order
+// of a ContractionHierarchy gives labels many times smaller.
+//
+// Every entry also stores the node's parent in its hub's search, i.e. the
+// next node towards the hub, so paths can be rebuilt hop by hop.
+// Blocked roads are left out. The adjacency type is the same as for
+// ContractionHierarchy (see CSRAdjacency).
+class HubLabels
+{
+private:
+    static constexpr int UNREACHABLE = numeric_limits<int>::max();
+
+    int n = 0;
+    vector<int> order; // hub rank -> node
+
+    // Labels in CSR form, sorted by hub rank within each node
+    vector<int> offset;
+    vector<int> hub;
+    vector<int> dist;
+    vector<int> parent;
+
+    // Position of hub rank h in v's label, -1 if absent.
+    int entry(int v, int h) const
+    {
+        auto first = hub.begin() + offset[v], last = hub.begin() + offset[v + 1];
+        auto it = lower_bound(first, last, h);
+        return it != last && *it == h ? (int)(it - hub.begin()) : -1;
+    }
+
+    // Scalar merge; also reports the hub rank of the best meeting point.
+    int mergeScalar(int i, int iEnd, int j, int jEnd, int &bestHub) const
+    {
+        long long best = UNREACHABLE;
+        bestHub = -1;
+        while (i < iEnd && j < jEnd)
+        {
+            if (hub[i] < hub[j])
+                i++;
+            else if (hub[i] > hub[j])
+                j++;
+            else
+            {
+                if ((long long)dist[i] + dist[j] < best)
+                {
+                    best = (long long)dist[i] + dist[j];
+                    bestHub = hub[i];
+                }
+                i++;
+                j++;
+            }
+        }
+        return best >= UNREACHABLE ? UNREACHABLE : (int)best;
+    }
+
+#if defined(__SSE2__)
+    // Four hubs of each label are compared at once: the block of t's label
+    // is rotated three times so every pair of lanes meets once, and the sums
+    // of matching lanes are folded into a running minimum. Then the block
+    // with the smaller last hub moves on, as in the scalar merge.
+    // Distances are assumed to stay below 2^30 so a sum cannot overflow.
+    int mergeSimd(int i, int iEnd, int j, int jEnd) const
+    {
+        const __m128i none = _mm_set1_epi32(UNREACHABLE);
+        __m128i best = none;
+        while (i + 4 <= iEnd && j + 4 <= jEnd)
+        {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&hub[i]));
+            __m128i da = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&dist[i]));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&hub[j]));
+            __m128i db = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&dist[j]));
+            for (int r = 0; r < 4; r++)
+            {
+                __m128i match = _mm_cmpeq_epi32(a, b);
+                __m128i sum = _mm_or_si128(_mm_and_si128(match, _mm_add_epi32(da, db)), _mm_andnot_si128(match, none));
+                __m128i smaller = _mm_cmplt_epi32(sum, best);
+                best = _mm_or_si128(_mm_and_si128(smaller, sum), _mm_andnot_si128(smaller, best));
+                b = _mm_shuffle_epi32(b, _MM_SHUFFLE(0, 3, 2, 1));
+                db = _mm_shuffle_epi32(db, _MM_SHUFFLE(0, 3, 2, 1));
+            }
+            int lastA = hub[i + 3], lastB = hub[j + 3];
+            if (lastA <= lastB)
+                i += 4;
+            if (lastB <= lastA)
+                j += 4;
+        }
+        int lanes[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), best);
+        int result = min(min(lanes[0], lanes[1]), min(lanes[2], lanes[3]));
+        // The tails (and any block partner skipped above) go through the scalar merge
+        int ignored;
+        return min(result, mergeScalar(i, iEnd, j, jEnd, ignored));
+    }
+#endif
+
+public:
+    bool isBuilt() const { return !offset.empty(); }
+    int nodeCount() const { return n; }
+    size_t labelSize() const { return hub.size(); }
+
+    // Pruned landmark labeling with the given hub order (most important
+    // first, every node once); without one, nodes are ranked by degree.
+    // Time complexity O(sum over hubs of the pruned search), about O(V L log V)
+    // for an average label size L
+    template <typename Adjacency>
+    void build(const Adjacency &g, const vector<int> &hubOrder = {})
+    {
+        n = g.nodeCount();
+        if ((int)hubOrder.size() == n)
+            order = hubOrder;
+        else
+        {
+            order.resize(n);
+            for (int v = 0; v < n; v++)
+                order[v] = v;
+            stable_sort(order.begin(), order.end(), [&](int a, int b)
+                        { return g.end(a) - g.begin(a) > g.end(b) - g.begin(b); });
+        }
+
+        vector<vector<int>> lHub(n), lDist(n), lParent(n);
+        vector<int> d(n, UNREACHABLE), par(n, -1), hubDist(n, UNREACHABLE);
+        vector<int> touched;
+        for (int h = 0; h < n; h++)
+        {
+            int root = order[h];
+            // The root's own label, indexed by hub, for O(|label|) pruning tests
+            for (size_t k = 0; k < lHub[root].size(); k++)
+                hubDist[lHub[root][k]] = lDist[root][k];
+
+            priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq;
+            d[root] = 0;
+            touched.push_back(root);
+            pq.push({0, root});
+            while (!pq.empty())
+            {
+                int du = pq.top().first, u = pq.top().second;
+                pq.pop();
+                if (du > d[u])
+                    continue;
+                bool covered = false;
+                for (size_t k = 0; k < lHub[u].size() && !covered; k++)
+                {
+                    int via = hubDist[lHub[u][k]];
+                    covered = via != UNREACHABLE && (long long)via + lDist[u][k] <= du;
+                }
+                if (covered)
+                    continue;
+                lHub[u].push_back(h);
+                lDist[u].push_back(du);
+                lParent[u].push_back(par[u]);
+
+                for (int e = g.begin(u); e < g.end(u); e++)
+                {
+                    if (g.blocked[e])
+                        continue;
+                    int v = g.target[e];
+                    if (du + g.weight[e] < d[v])
+                    {
+                        if (d[v] == UNREACHABLE)
+                            touched.push_back(v);
+                        d[v] = du + g.weight[e];
+                        par[v] = u;
+                        pq.push({d[v], v});
+                    }
+                }
+            }
+
+            for (int v : touched)
+            {
+                d[v] = UNREACHABLE;
+                par[v] = -1;
+            }
+            touched.clear();
+            for (int x : lHub[root])
+                hubDist[x] = UNREACHABLE;
+        }
+
+        offset.assign(n + 1, 0);
+        for (int v = 0; v < n; v++)
+            offset[v + 1] = offset[v] + (int)lHub[v].size();
+        hub.clear();
+        dist.clear();
+        parent.clear();
+        hub.reserve(offset[n]);
+        dist.reserve(offset[n]);
+        parent.reserve(offset[n]);
+        for (int v = 0; v < n; v++)
+        {
+            hub.insert(hub.end(), lHub[v].begin(), lHub[v].end());
+            dist.insert(dist.end(), lDist[v].begin(), lDist[v].end());
+            parent.insert(parent.end(), lParent[v].begin(), lParent[v].end());
+        }
+    }
+
+    // Distance between two dense node indices, -1 if unreachable or unknown
+    // (nodes added after build()).
+    // Time complexity O(|L(s)| + |L(t)|)
+    int distance(int s, int t) const
+    {
+        if (s == t)
+            return 0;
+        if (s < 0 || t < 0 || s >= n || t >= n)
+            return -1;
+        int best;
+#if defined(__SSE2__)
+        best = mergeSimd(offset[s], offset[s + 1], offset[t], offset[t + 1]);
+#else
+        int ignored;
+        best = mergeScalar(offset[s], offset[s + 1], offset[t], offset[t + 1], ignored);
+#endif
+        return best == UNREACHABLE ? -1 : best;
+    }
+
+    // Distance and node sequence s .. t, {-1, {}} if unreachable.
+    // Time complexity O(|L(s)| + |L(t)| + P log L), P = path length
+    pair<int, vector<int>> path(int s, int t) const
+    {
+        if (s == t && s >= 0)
+            return {0, {s}};
+        if (s < 0 || t < 0 || s >= n || t >= n)
+            return {-1, {}};
+        int h;
+        int best = mergeScalar(offset[s], offset[s + 1], offset[t], offset[t + 1], h);
+        if (best == UNREACHABLE)
+            return {-1, {}};
+
+        // Both halves walk towards the hub along the stored parents
+        vector<int> result, back;
+        for (int v = s; v != -1; v = parent[entry(v, h)])
+            result.push_back(v);
+        for (int v = t; v != -1; v = parent[entry(v, h)])
+            back.push_back(v);
+        back.pop_back(); // the hub is already at the end of 'result'
+        result.insert(result.end(), back.rbegin(), back.rend());
+        return {best, result};
+    }
+};
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef K_SHORTEST_PATHS_H
+#define K_SHORTEST_PATHS_H
+
+#include <vector>
+#include <set>
+#include <queue>
+#include <limits>
+#include <algorithm>
+
+using namespace std;
+
+// Yen's algorithm for the K shortest loopless routes between two nodes of an
+// undirected road network. Route i+1 is found by leaving route i at each of
+// its nodes (the "spur") and searching the best way on to t that neither goes
+// back through the part before the spur nor continues like a route already
+// found with the same beginning.
+//
+// Routes are node sequences; between two neighbouring nodes the cheapest
+// unblocked road is taken, so parallel roads do not count as different routes.
+// The adjacency type is the same as for ContractionHierarchy (see CSRAdjacency).
+
+struct KShortestScratch
+{
+    vector<int> dist, parent;
+    vector<int> touched;
+    vector<char> banned; // nodes the current spur search may not enter
+};
+
+// Dijkstra from s to t that avoids banned nodes and, at s itself, the arcs
+// leading to a node in 'skipFirst'. Appends the nodes after s to 'path' and
+// returns the cost, or numeric_limits<int>::max() if t cannot be reached.
+template <typename Adjacency>
+int spurSearch(const Adjacency &g, int s, int t, const vector<int> &skipFirst, KShortestScratch &sc, vector<int> &path)
+{
+    const int UNREACHABLE = numeric_limits<int>::max();
+    priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq;
+    sc.dist[s] = 0;
+    sc.touched.push_back(s);
+    pq.push({0, s});
+    while (!pq.empty())
+    {
+        int d = pq.top().first, u = pq.top().second;
+        pq.pop();
+        if (d > sc.dist[u])
+            continue;
+        if (u == t)
+            break;
+        for (int e = g.begin(u); e < g.end(u); e++)
+        {
+            int v = g.target[e];
+            if (g.blocked[e] || sc.banned[v])
+                continue;
+            if (u == s && find(skipFirst.begin(), skipFirst.end(), v) != skipFirst.end())
+                continue;
+            if (d + g.weight[e] < sc.dist[v])
+            {
+                if (sc.dist[v] == UNREACHABLE)
+                    sc.touched.push_back(v);
+                sc.dist[v] = d + g.weight[e];
+                sc.parent[v] = u;
+                pq.push({sc.dist[v], v});
+            }
+        }
+    }
+
+    int cost = sc.dist[t];
+    if (cost != UNREACHABLE)
+    {
+        size_t first = path.size();
+        for (int v = t; v != s; v = sc.parent[v])
+            path.push_back(v);
+        reverse(path.begin() + first, path.end());
+    }
+    for (int v : sc.touched)
+    {
+        sc.dist[v] = UNREACHABLE;
+        sc.parent[v] = -1;
+    }
+    sc.touched.clear();
+    return cost;
+}
+
+// Cost of the cheapest unblocked road between neighbours u and v.
+template <typename Adjacency>
+int roadCost(const Adjacency &g, int u, int v)
+{
+    int best = numeric_limits<int>::max();
+    for (int e = g.begin(u); e < g.end(u); e++)
+        if (g.target[e] == v && !g.blocked[e])
+            best = min(best, g.weight[e]);
+    return best;
+}
+
+// Up to k routes from s to t as {cost, nodes s .. t}, cheapest first.
+// Fewer are returned if there are not that many loopless routes.
+// Time complexity O(k L (V + E) log V), L = number of nodes on a route
+template <typename Adjacency>
+vector<pair<int, vector<int>>> kShortestPaths(const Adjacency &g, int s, int t, int k)
+{
+    vector<pair<int, vector<int>>> routes;
+    int n = g.nodeCount();
+    if (k <= 0 || s < 0 || t < 0 || s >= n || t >= n)
+        return routes;
+    if (s == t)
+        return {{0, {s}}};
+
+    thread_local KShortestScratch sc;
+    if ((int)sc.dist.size() != n)
+    {
+        sc.dist.assign(n, numeric_limits<int>::max());
+        sc.parent.assign(n, -1);
+        sc.banned.assign(n, 0);
+        sc.touched.clear();
+    }
+
+    vector<int> first = {s};
+    int cost = spurSearch(g, s, t, {}, sc, first);
+    if (cost == numeric_limits<int>::max())
+        return routes;
+    routes.push_back({cost, first});
+
+    // Candidates ordered by cost; the set also drops duplicates
+    set<pair<int, vector<int>>> candidates;
+    while ((int)routes.size() < k)
+    {
+        const vector<int> previous = routes.back().second;
+        int rootCost = 0;
+        for (size_t i = 0; i + 1 < previous.size(); i++)
+        {
+            int spur = previous[i];
+            // Found routes that start like this one must not be repeated
+            vector<int> skip;
+            for (const auto &r : routes)
+                if (r.second.size() > i + 1 && equal(previous.begin(), previous.begin() + i + 1, r.second.begin()))
+                    skip.push_back(r.second[i + 1]);
+
+            for (size_t j = 0; j < i; j++)
+                sc.banned[previous[j]] = 1;
+            vector<int> route(previous.begin(), previous.begin() + i + 1);
+            int spurCost = spurSearch(g, spur, t, skip, sc, route);
+            for (size_t j = 0; j < i; j++)
+                sc.banned[previous[j]] = 0;
+
+            if (spurCost != numeric_limits<int>::max())
+                candidates.insert({rootCost + spurCost, route});
+            rootCost += roadCost(g, previous[i], previous[i + 1]);
+        }
+        if (candidates.empty())
+            break;
+        routes.push_back(*candidates.begin());
+        candidates.erase(candidates.begin());
+    }
+    return routes;
+}
+
+#endif
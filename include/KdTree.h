@@ -0,0 +1,170 @@
+#ifndef KD_TREE_H
+#define KD_TREE_H
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+// 2-d tree over the city coordinates for nearest-city queries, keyed by
+// dense node index.
+//
+// Cities are added one at a time, so the points are kept in a few static,
+// perfectly balanced trees ("blocks") instead of one (the logarithmic
+// method): a new point is a block of its own, and blocks of similar size are
+// merged and rebuilt, so every point is rebuilt O(log V) times in total and
+// there are never more than O(log V) blocks. Blocks are immutable and shared
+// between versions like the rest of a GraphSnapshot.
+//
+// A city that moves is inserted again at its new position; the entry at the
+// old position is recognized as stale by the caller's check (the city's
+// current coordinates differ) and skipped. Once stale entries make up half
+// of the tree, needsRebuild() asks for a fresh build.
+class KdTree
+{
+private:
+    struct Point
+    {
+        int id;
+        float x, y;
+    };
+
+    // Implicit balanced tree: the median of [lo, hi) (by x on even depths, by
+    // y on odd ones) sits at (lo + hi) / 2, its halves on either side.
+    struct Block
+    {
+        vector<Point> points;
+    };
+
+    vector<shared_ptr<const Block>> blocks; // largest first
+    int total = 0;
+    int stale = 0;
+
+    static void arrange(vector<Point> &pts, int lo, int hi, int depth)
+    {
+        if (hi - lo <= 1)
+            return;
+        int mid = (lo + hi) / 2;
+        nth_element(pts.begin() + lo, pts.begin() + mid, pts.begin() + hi, [depth](const Point &a, const Point &b)
+                    { return depth % 2 == 0 ? a.x < b.x : a.y < b.y; });
+        arrange(pts, lo, mid, depth + 1);
+        arrange(pts, mid + 1, hi, depth + 1);
+    }
+
+    static shared_ptr<const Block> makeBlock(vector<Point> pts)
+    {
+        auto b = make_shared<Block>();
+        b->points = move(pts);
+        arrange(b->points, 0, b->points.size(), 0);
+        return b;
+    }
+
+    // Bounded max-heap of the k best (squared distance, id) found so far.
+    // A city that moved back to an old position has two live entries; the
+    // second one must not take another slot.
+    struct Best
+    {
+        vector<pair<double, int>> heap;
+        size_t k;
+
+        bool full() const { return heap.size() >= k; }
+        double worst() const { return heap.front().first; }
+
+        void offer(double d, int id)
+        {
+            if (full() && d >= worst())
+                return;
+            for (const auto &e : heap)
+                if (e.second == id)
+                    return;
+            if (full())
+            {
+                pop_heap(heap.begin(), heap.end());
+                heap.pop_back();
+            }
+            heap.push_back({d, id});
+            push_heap(heap.begin(), heap.end());
+        }
+    };
+
+    template <typename Accept>
+    static void search(const vector<Point> &pts, int lo, int hi, int depth, double x, double y,
+                       Accept &accept, Best &best)
+    {
+        if (lo >= hi)
+            return;
+        int mid = (lo + hi) / 2;
+        const Point &p = pts[mid];
+        if (accept(p.id, p.x, p.y))
+        {
+            double dx = p.x - x, dy = p.y - y;
+            best.offer(dx * dx + dy * dy, p.id);
+        }
+        double diff = depth % 2 == 0 ? x - p.x : y - p.y;
+        // The side of the splitting line the query lies on first; the other
+        // side only if it can still hold something closer.
+        if (diff < 0)
+            search(pts, lo, mid, depth + 1, x, y, accept, best);
+        else
+            search(pts, mid + 1, hi, depth + 1, x, y, accept, best);
+        if (!best.full() || diff * diff < best.worst())
+        {
+            if (diff < 0)
+                search(pts, mid + 1, hi, depth + 1, x, y, accept, best);
+            else
+                search(pts, lo, mid, depth + 1, x, y, accept, best);
+        }
+    }
+
+public:
+    // Time complexity O(V log V)
+    void build(const vector<int> &ids, const vector<pair<float, float>> &coords)
+    {
+        vector<Point> pts(ids.size());
+        for (size_t i = 0; i < ids.size(); i++)
+            pts[i] = {ids[i], coords[i].first, coords[i].second};
+        blocks.clear();
+        if (!pts.empty())
+            blocks.push_back(makeBlock(move(pts)));
+        total = ids.size();
+        stale = 0;
+    }
+
+    // Time complexity O(log^2 V) amortized
+    void insert(int id, float x, float y)
+    {
+        vector<Point> pts = {{id, x, y}};
+        // Merge with the smaller blocks at the end while they are not larger
+        while (!blocks.empty() && blocks.back()->points.size() <= pts.size())
+        {
+            const vector<Point> &last = blocks.back()->points;
+            pts.insert(pts.end(), last.begin(), last.end());
+            blocks.pop_back();
+        }
+        blocks.push_back(makeBlock(move(pts)));
+        total++;
+    }
+
+    // An entry went stale (its city moved and was inserted again).
+    void markStale() { stale++; }
+    bool needsRebuild() const { return stale > 0 && 2 * stale >= total; }
+
+    // Up to k closest points accepted by accept(id, x, y), as {squared distance,
+    // id}, nearest first. accept must reject stale entries.
+    // Time complexity O(log^2 V + k log V) for well-spread points
+    template <typename Accept>
+    vector<pair<double, int>> nearest(double x, double y, int k, Accept accept) const
+    {
+        Best best;
+        best.k = max(k, 0);
+        if (k > 0)
+            for (const auto &b : blocks)
+                search(b->points, 0, b->points.size(), 0, x, y, accept, best);
+        sort_heap(best.heap.begin(), best.heap.end());
+        return best.heap;
+    }
+};
+
+#endif
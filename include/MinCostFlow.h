@@ -0,0 +1,155 @@
+#ifndef MIN_COST_FLOW_H
+#define MIN_COST_FLOW_H
+
+#include <vector>
+#include <queue>
+#include <limits>
+#include <algorithm>
+
+using namespace std;
+
+// Minimum-cost flow by successive shortest paths. Every round runs Dijkstra
+// from s on the residual network and pushes as much flow as the cheapest
+// path to t takes. Dijkstra needs non-negative arc costs, which the residual
+// (backward) arcs do not have; node potentials fix that: with pi = the
+// distances of the previous round, the reduced cost c(u,v) + pi(u) - pi(v)
+// of every residual arc is >= 0 (Johnson). Arc costs must be >= 0 to start.
+//
+// Nodes are 0 .. n-1; arcs are added before solve().
+class MinCostFlow
+{
+private:
+    struct Arc
+    {
+        int to;
+        int rev;       // index of the opposite arc in to's list
+        long long cap; // residual capacity
+        long long cost;
+        bool forward;  // added by addArc (not a residual back arc)
+    };
+
+    vector<vector<Arc>> out;
+
+public:
+    explicit MinCostFlow(int n) : out(n) {}
+
+    int nodeCount() const { return out.size(); }
+
+    // Arc u -> v (u != v). Returns its position in u's list, for flowOn().
+    int addArc(int u, int v, long long cap, long long cost)
+    {
+        out[u].push_back({v, (int)out[v].size(), cap, cost, true});
+        out[v].push_back({u, (int)out[u].size() - 1, 0, -cost, false});
+        return out[u].size() - 1;
+    }
+
+    // Sends up to 'limit' units from s to t at the least total cost.
+    // Returns {flow, cost}.
+    // Time complexity O(A (E log V)), A = augmenting paths (at most 'limit')
+    pair<long long, long long> solve(int s, int t, long long limit)
+    {
+        const long long UNREACHED = numeric_limits<long long>::max();
+        int n = out.size();
+        vector<long long> pi(n, 0), dist(n);
+        vector<int> prevNode(n), prevArc(n);
+        long long flow = 0, cost = 0;
+        while (flow < limit)
+        {
+            fill(dist.begin(), dist.end(), UNREACHED);
+            dist[s] = 0;
+            priority_queue<pair<long long, int>, vector<pair<long long, int>>, greater<pair<long long, int>>> pq;
+            pq.push({0, s});
+            while (!pq.empty())
+            {
+                long long d = pq.top().first;
+                int u = pq.top().second;
+                pq.pop();
+                if (d > dist[u])
+                    continue;
+                for (int i = 0; i < (int)out[u].size(); i++)
+                {
+                    const Arc &a = out[u][i];
+                    if (a.cap <= 0)
+                        continue;
+                    long long nd = d + a.cost + pi[u] - pi[a.to];
+                    if (nd < dist[a.to])
+                    {
+                        dist[a.to] = nd;
+                        prevNode[a.to] = u;
+                        prevArc[a.to] = i;
+                        pq.push({nd, a.to});
+                    }
+                }
+            }
+            if (dist[t] == UNREACHED)
+                break;
+            for (int v = 0; v < n; v++)
+                if (dist[v] != UNREACHED)
+                    pi[v] += dist[v];
+
+            long long push = limit - flow;
+            for (int v = t; v != s; v = prevNode[v])
+                push = min(push, out[prevNode[v]][prevArc[v]].cap);
+            for (int v = t; v != s; v = prevNode[v])
+            {
+                Arc &a = out[prevNode[v]][prevArc[v]];
+                a.cap -= push;
+                out[v][a.rev].cap += push;
+                cost += push * a.cost;
+            }
+            flow += push;
+        }
+        return {flow, cost};
+    }
+
+    // Flow on u's i-th forward arc (the opposite arc's residual capacity).
+    long long flowOn(int u, int i) const
+    {
+        const Arc &a = out[u][i];
+        return a.forward ? out[a.to][a.rev].cap : 0;
+    }
+
+    // Removes one unit of flow along a path from s to t and returns the path
+    // and its cost (flow decomposition); empty once no flow reaches t.
+    // Zero-cost arcs (roads of length 0) can carry flow around a cycle, so
+    // the path is found first, by a depth-first search that enters every
+    // node once, and only then is the flow taken off its arcs.
+    // Time complexity O(V + E)
+    vector<int> takePath(int s, int t, long long &cost)
+    {
+        vector<char> visited(out.size(), 0);
+        vector<pair<int, int>> stack = {{s, 0}}; // {node, next arc to try}
+        visited[s] = 1;
+        while (!stack.empty() && stack.back().first != t)
+        {
+            int u = stack.back().first;
+            int &i = stack.back().second;
+            while (i < (int)out[u].size() && (flowOn(u, i) <= 0 || visited[out[u][i].to]))
+                i++;
+            if (i == (int)out[u].size())
+            {
+                stack.pop_back();
+                continue;
+            }
+            int v = out[u][i].to;
+            visited[v] = 1;
+            stack.push_back({v, 0});
+        }
+        cost = 0;
+        if (stack.empty())
+            return {};
+        vector<int> path;
+        for (size_t k = 0; k < stack.size(); k++)
+        {
+            path.push_back(stack[k].first);
+            if (k + 1 == stack.size())
+                break;
+            Arc &a = out[stack[k].first][stack[k].second];
+            out[a.to][a.rev].cap--; // the flow, not the residual capacity
+            cost += a.cost;
+        }
+        return path;
+    }
+};
+
+#endif
@@ -48,9 +48,50 @@ struct Package
     double price; // [NEW] Price field
 
     string historyStr;
-    string routeStr;
+    vector<int> route; // future route as city ids (Node::id), see encodeRoute
+    string routeStr;   // legacy "CityA,CityB" plan of rows written before the Route column
 };
 
+// Route plans are stored as a BLOB of LEB128 varints, one per city id:
+// 7 bits per byte, the high bit set on every byte but the last. Ids below
+// 128 take a single byte, against the name plus a comma for the old text plan.
+inline string encodeRoute(const vector<int> &route)
+{
+    string out;
+    out.reserve(route.size());
+    for (int id : route)
+    {
+        unsigned int v = id;
+        while (v >= 0x80)
+        {
+            out.push_back((char)(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back((char)v);
+    }
+    return out;
+}
+
+inline vector<int> decodeRoute(const void *blob, int bytes)
+{
+    vector<int> route;
+    const unsigned char *data = static_cast<const unsigned char *>(blob);
+    unsigned int v = 0;
+    int shift = 0;
+    for (int i = 0; i < bytes; i++)
+    {
+        v |= (unsigned int)(data[i] & 0x7F) << shift;
+        shift += 7;
+        if (!(data[i] & 0x80))
+        {
+            route.push_back((int)v);
+            v = 0;
+            shift = 0;
+        }
+    }
+    return route;
+}
+
 class PackageDatabase
 {
 private:
@@ -69,11 +110,12 @@ public:
                           "SourceCity TEXT, DestCity TEXT, CurrentCity TEXT, "
                           "Type INT, Weight REAL, Status INT, Ticks INT, "
                           "History TEXT, RoutePlan TEXT, RiderID INT DEFAULT 0, "
-                          "Attempts INT DEFAULT 0, Price REAL DEFAULT 0.0);";
+                          "Attempts INT DEFAULT 0, Price REAL DEFAULT 0.0, Route BLOB);";
 
         // Migration helpers for existing databases
         sqlite3_exec(db_, sql, nullptr, nullptr, nullptr);
         sqlite3_exec(db_, "ALTER TABLE Packages ADD COLUMN Price REAL DEFAULT 0.0;", nullptr, nullptr, nullptr);
+        sqlite3_exec(db_, "ALTER TABLE Packages ADD COLUMN Route BLOB;", nullptr, nullptr, nullptr);
     }
     ~PackageDatabase()
     {
@@ -82,9 +124,10 @@ public:
     }
 
     // [UPDATED] Add Package with Price
+    // The route plan goes to the Route column, RoutePlan stays empty.
     void addPackage(const Package &p)
     {
-        string sql = "INSERT INTO Packages (Sender, Receiver, Address, SourceCity, DestCity, CurrentCity, Type, Weight, Status, Ticks, History, RoutePlan, Price) "
+        string sql = "INSERT INTO Packages (Sender, Receiver, Address, SourceCity, DestCity, CurrentCity, Type, Weight, Status, Ticks, History, Route, Price) "
                      "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, 0, ?, ?, ?);";
         sqlite3_stmt *stmt;
         sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr);
@@ -98,26 +141,64 @@ public:
         sqlite3_bind_double(stmt, 8, p.weight);
         sqlite3_bind_int(stmt, 9, p.status);
         sqlite3_bind_text(stmt, 10, p.historyStr.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 11, p.routeStr.c_str(), -1, SQLITE_STATIC);
+        string route = encodeRoute(p.route);
+        sqlite3_bind_blob(stmt, 11, route.data(), route.size(), SQLITE_STATIC);
         sqlite3_bind_double(stmt, 12, p.price); // Bind Price
         sqlite3_step(stmt);
         sqlite3_finalize(stmt);
     }
 
-    void updateStatusAndRoute(int id, int status, string currentCity, string history, string routePlan)
+    // Saving a new route also clears a legacy text plan.
+    void updateStatusAndRoute(int id, int status, const string &currentCity, const string &history, const vector<int> &route)
     {
-        string sql = "UPDATE Packages SET Status = ?, CurrentCity = ?, History = ?, RoutePlan = ? WHERE ID = ?";
+        string sql = "UPDATE Packages SET Status = ?, CurrentCity = ?, History = ?, Route = ?, RoutePlan = NULL WHERE ID = ?";
         sqlite3_stmt *stmt;
         sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr);
         sqlite3_bind_int(stmt, 1, status);
         sqlite3_bind_text(stmt, 2, currentCity.c_str(), -1, SQLITE_STATIC);
         sqlite3_bind_text(stmt, 3, history.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 4, routePlan.c_str(), -1, SQLITE_STATIC);
+        string blob = encodeRoute(route);
+        sqlite3_bind_blob(stmt, 4, blob.data(), blob.size(), SQLITE_STATIC);
         sqlite3_bind_int(stmt, 5, id);
         sqlite3_step(stmt);
         sqlite3_finalize(stmt);
     }
 
+    // Route plans of many packages (id, city ids) in one transaction, so a
+    // dispatch plan is stored completely or not at all.
+    bool updateRoutes(const vector<pair<int, vector<int>>> &routes)
+    {
+        sqlite3_exec(db_, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+        string sql = "UPDATE Packages SET Route = ?, RoutePlan = NULL WHERE ID = ?";
+        sqlite3_stmt *stmt;
+        sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr);
+        bool ok = true;
+        for (const auto &r : routes)
+        {
+            string blob = encodeRoute(r.second);
+            sqlite3_bind_blob(stmt, 1, blob.data(), blob.size(), SQLITE_STATIC);
+            sqlite3_bind_int(stmt, 2, r.first);
+            ok = sqlite3_step(stmt) == SQLITE_DONE;
+            sqlite3_reset(stmt);
+            if (!ok)
+                break;
+        }
+        sqlite3_finalize(stmt);
+        sqlite3_exec(db_, ok ? "COMMIT;" : "ROLLBACK;", nullptr, nullptr, nullptr);
+        return ok;
+    }
+
+    void updateStatus(int id, int status)
+    {
+        string sql = "UPDATE Packages SET Status = ? WHERE ID = ?";
+        sqlite3_stmt *stmt;
+        sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr);
+        sqlite3_bind_int(stmt, 1, status);
+        sqlite3_bind_int(stmt, 2, id);
+        sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+    }
+
     void updateTicks(int id, int ticks)
     {
         string sql = "UPDATE Packages SET Ticks = ? WHERE ID = ?";
@@ -176,6 +257,7 @@ public:
         p.riderId = sqlite3_column_int(stmt, 13);
         p.attempts = sqlite3_column_int(stmt, 14);
         p.price = sqlite3_column_double(stmt, 15); // [NEW] Extract Price
+        p.route = decodeRoute(sqlite3_column_blob(stmt, 16), sqlite3_column_bytes(stmt, 16));
 
         return p;
     }
@@ -0,0 +1,155 @@
+#ifndef PRIORITY_QUEUES_H
+#define PRIORITY_QUEUES_H
+
+#include <vector>
+#include <queue>
+#include <limits>
+#include <cstdint>
+
+using namespace std;
+
+// Min-priority queues for the Dijkstra / A* searches in CustomGraph.h.
+// All of them store (key, node) pairs with non-negative int keys and share
+// the same interface, so a search can take the queue type as a template
+// parameter:
+//
+//   reset(maxStep) - empty the queue; maxStep bounds how far a pushed key can
+//                    lie above the last popped key (the largest edge weight
+//                    for Dijkstra, twice that for A* with a consistent bound)
+//   push(key, node), pop() -> {key, node}, empty()
+//
+// The radix heap and the Dial queue are monotone: a pushed key may never be
+// smaller than the last popped one, which always holds for Dijkstra and for
+// A* with a consistent heuristic.
+
+enum QueueKind
+{
+    QUEUE_AUTO,   // pick from the largest edge weight (see chooseQueue)
+    QUEUE_BINARY, // std::priority_queue with lazy deletion
+    QUEUE_RADIX,  // radix heap, O(log C) amortized
+    QUEUE_DIAL    // circular bucket queue, O(1) per operation plus bucket scans
+};
+
+// Dial's bucket array grows with the edge weights, so it is only used when
+// the heaviest road is short; above that the radix heap wins.
+const int DIAL_MAX_WEIGHT = 4096;
+
+inline QueueKind chooseQueue(int maxWeight)
+{
+    return maxWeight <= DIAL_MAX_WEIGHT ? QUEUE_DIAL : QUEUE_RADIX;
+}
+
+class BinaryHeapQueue
+{
+private:
+    priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq;
+
+public:
+    void reset(int)
+    {
+        pq = decltype(pq)();
+    }
+    void push(int key, int node) { pq.push({key, node}); }
+    pair<int, int> pop()
+    {
+        pair<int, int> top = pq.top();
+        pq.pop();
+        return top;
+    }
+    bool empty() const { return pq.empty(); }
+};
+
+// Radix heap: bucket i holds keys whose highest bit differing from the last
+// popped key is bit i - 1. Popping redistributes the first non-empty bucket
+// around its minimum, and every key moves down at most 32 times.
+class RadixHeapQueue
+{
+private:
+    vector<pair<uint32_t, int>> buckets[33];
+    uint32_t last = 0;
+    size_t count = 0;
+
+    static int bucketOf(uint32_t key, uint32_t last)
+    {
+        return key == last ? 0 : 32 - __builtin_clz(key ^ last);
+    }
+
+public:
+    void reset(int)
+    {
+        for (auto &b : buckets)
+            b.clear();
+        last = 0;
+        count = 0;
+    }
+    void push(int key, int node)
+    {
+        buckets[bucketOf((uint32_t)key, last)].push_back({(uint32_t)key, node});
+        count++;
+    }
+    pair<int, int> pop()
+    {
+        if (buckets[0].empty())
+        {
+            int i = 1;
+            while (buckets[i].empty())
+                i++;
+            uint32_t smallest = numeric_limits<uint32_t>::max();
+            for (const auto &entry : buckets[i])
+                smallest = min(smallest, entry.first);
+            last = smallest;
+            for (const auto &entry : buckets[i])
+                buckets[bucketOf(entry.first, last)].push_back(entry);
+            buckets[i].clear();
+        }
+        pair<uint32_t, int> top = buckets[0].back();
+        buckets[0].pop_back();
+        count--;
+        return {(int)top.first, top.second};
+    }
+    bool empty() const { return count == 0; }
+};
+
+// Dial's algorithm: maxStep + 1 circular buckets. Live keys always lie in
+// [current, current + maxStep], so bucket key % size holds exactly one key.
+class DialQueue
+{
+private:
+    vector<vector<int>> buckets;
+    int current = -1; // last popped key, -1 until the first push
+    size_t count = 0;
+
+public:
+    void reset(int maxStep)
+    {
+        if ((int)buckets.size() != maxStep + 1)
+            buckets.assign(maxStep + 1, vector<int>());
+        else
+            for (auto &b : buckets)
+                b.clear();
+        current = -1;
+        count = 0;
+    }
+    void push(int key, int node)
+    {
+        // The first key (h(s) for A*) may be far from zero; the window starts there.
+        if (current < 0)
+            current = key;
+        buckets[key % buckets.size()].push_back(node);
+        count++;
+    }
+    pair<int, int> pop()
+    {
+        size_t size = buckets.size();
+        while (buckets[current % size].empty())
+            current++;
+        vector<int> &bucket = buckets[current % size];
+        int node = bucket.back();
+        bucket.pop_back();
+        count--;
+        return {current, node};
+    }
+    bool empty() const { return count == 0; }
+};
+
+#endif
@@ -0,0 +1,366 @@
+#ifndef QUAD_TREE_H
+#define QUAD_TREE_H
+
+#include <vector>
+#include <memory>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+// Axis-aligned rectangle in map coordinates (closed on all sides).
+struct MapBox
+{
+    double minX = 0, minY = 0, maxX = -1, maxY = -1; // default: empty
+
+    bool empty() const { return maxX < minX || maxY < minY; }
+    double width() const { return maxX - minX; }
+    double height() const { return maxY - minY; }
+
+    bool contains(double x, double y) const
+    {
+        return x >= minX && x <= maxX && y >= minY && y <= maxY;
+    }
+
+    bool intersects(const MapBox &b) const
+    {
+        return !empty() && !b.empty() && minX <= b.maxX && b.minX <= maxX && minY <= b.maxY && b.minY <= maxY;
+    }
+
+    void add(double x, double y)
+    {
+        if (empty())
+        {
+            minX = maxX = x;
+            minY = maxY = y;
+            return;
+        }
+        minX = min(minX, x);
+        maxX = max(maxX, x);
+        minY = min(minY, y);
+        maxY = max(maxY, y);
+    }
+
+    void add(const MapBox &b)
+    {
+        if (b.empty())
+            return;
+        add(b.minX, b.minY);
+        add(b.maxX, b.maxY);
+    }
+
+    MapBox expanded(double margin) const
+    {
+        return empty() ? *this : MapBox{minX - margin, minY - margin, maxX + margin, maxY + margin};
+    }
+
+    // True if the segment a-b passes through the box (Liang-Barsky clipping).
+    bool intersectsSegment(double ax, double ay, double bx, double by) const
+    {
+        if (empty())
+            return false;
+        double t0 = 0.0, t1 = 1.0;
+        double dx = bx - ax, dy = by - ay;
+        double p[4] = {-dx, dx, -dy, dy};
+        double q[4] = {ax - minX, maxX - ax, ay - minY, maxY - ay};
+        for (int i = 0; i < 4; i++)
+        {
+            if (p[i] == 0.0)
+            {
+                if (q[i] < 0.0)
+                    return false;
+                continue;
+            }
+            double t = q[i] / p[i];
+            if (p[i] < 0.0)
+                t0 = max(t0, t);
+            else
+                t1 = min(t1, t);
+            if (t0 > t1)
+                return false;
+        }
+        return true;
+    }
+};
+
+// Point quadtree over the city coordinates, keyed by dense node index.
+// Every cell keeps the number, coordinate sums and bounding box of the points
+// below it, so a whole cell can be reported as one cluster without visiting
+// its points.
+//
+// The tree is persistent like the rest of a GraphSnapshot: inserting, removing
+// or moving a point copies only the cells on its path and shares the others,
+// so the previous version stays valid for readers that pinned it.
+class QuadTree
+{
+public:
+    // A group of points too close together to tell apart at the requested
+    // scale, drawn as one marker at their centroid.
+    struct Cluster
+    {
+        int count;
+        double x, y; // centroid
+        MapBox extent;
+    };
+
+private:
+    static constexpr int CAPACITY = 8;   // points per leaf before it splits
+    static constexpr int MAX_DEPTH = 24; // leaves this deep never split (duplicates)
+
+    struct Point
+    {
+        int id;
+        double x, y;
+    };
+
+    struct Cell
+    {
+        int count = 0;
+        double sumX = 0, sumY = 0;
+        MapBox extent;         // of the points below this cell
+        vector<Point> points;  // leaves only
+        shared_ptr<const Cell> child[4];
+        bool leaf = true;
+    };
+
+    shared_ptr<const Cell> root;
+    MapBox area; // square covered by the root; points outside force a rebuild
+
+    // Quadrants split at the midpoint, lower half open: [min, mid) and [mid, max].
+    static int quadrant(const MapBox &a, double x, double y)
+    {
+        double midX = (a.minX + a.maxX) / 2, midY = (a.minY + a.maxY) / 2;
+        return (x >= midX ? 1 : 0) + (y >= midY ? 2 : 0);
+    }
+
+    static MapBox subArea(const MapBox &a, int q)
+    {
+        double midX = (a.minX + a.maxX) / 2, midY = (a.minY + a.maxY) / 2;
+        return {q & 1 ? midX : a.minX, q & 2 ? midY : a.minY, q & 1 ? a.maxX : midX, q & 2 ? a.maxY : midY};
+    }
+
+    static shared_ptr<const Cell> insert(const shared_ptr<const Cell> &c, const MapBox &a, const Point &p, int depth)
+    {
+        auto n = c ? make_shared<Cell>(*c) : make_shared<Cell>();
+        n->count++;
+        n->sumX += p.x;
+        n->sumY += p.y;
+        n->extent.add(p.x, p.y);
+        if (!n->leaf)
+        {
+            int q = quadrant(a, p.x, p.y);
+            n->child[q] = insert(n->child[q], subArea(a, q), p, depth + 1);
+            return n;
+        }
+        n->points.push_back(p);
+        if ((int)n->points.size() > CAPACITY && depth < MAX_DEPTH)
+        {
+            n->leaf = false;
+            for (const Point &x : n->points)
+            {
+                int q = quadrant(a, x.x, x.y);
+                n->child[q] = insert(n->child[q], subArea(a, q), x, depth + 1);
+            }
+            n->points.clear();
+        }
+        return n;
+    }
+
+    static void collect(const shared_ptr<const Cell> &c, vector<Point> &out)
+    {
+        if (!c)
+            return;
+        out.insert(out.end(), c->points.begin(), c->points.end());
+        for (const auto &ch : c->child)
+            collect(ch, out);
+    }
+
+    // Copy of c without point id at (x, y); c itself if the point is not there.
+    static shared_ptr<const Cell> erase(const shared_ptr<const Cell> &c, const MapBox &a, int id, double x, double y, bool &found)
+    {
+        if (!c || !c->extent.contains(x, y))
+            return c;
+        if (c->leaf)
+        {
+            auto it = find_if(c->points.begin(), c->points.end(), [&](const Point &p)
+                              { return p.id == id; });
+            if (it == c->points.end())
+                return c;
+            found = true;
+            if (c->count == 1)
+                return nullptr;
+            auto n = make_shared<Cell>();
+            for (const Point &p : c->points)
+                if (p.id != id)
+                {
+                    n->points.push_back(p);
+                    n->count++;
+                    n->sumX += p.x;
+                    n->sumY += p.y;
+                    n->extent.add(p.x, p.y);
+                }
+            return n;
+        }
+
+        int q = quadrant(a, x, y);
+        auto sub = erase(c->child[q], subArea(a, q), id, x, y, found);
+        if (!found)
+            return c;
+        auto n = make_shared<Cell>(*c);
+        n->child[q] = sub;
+        n->count--;
+        n->sumX -= x;
+        n->sumY -= y;
+        n->extent = MapBox();
+        for (const auto &ch : n->child)
+            if (ch)
+                n->extent.add(ch->extent);
+        if (n->count <= CAPACITY)
+        {
+            // Few enough points left to merge the children back into a leaf
+            vector<Point> rest;
+            collect(n, rest);
+            n->leaf = true;
+            n->points = rest;
+            for (auto &ch : n->child)
+                ch = nullptr;
+        }
+        return n;
+    }
+
+    static void query(const shared_ptr<const Cell> &c, const MapBox &box, vector<int> &out)
+    {
+        if (!c || !c->extent.intersects(box))
+            return;
+        for (const Point &p : c->points)
+            if (box.contains(p.x, p.y))
+                out.push_back(p.id);
+        for (const auto &ch : c->child)
+            query(ch, box, out);
+    }
+
+    // A cell whose points all lie within 'cellSize' of each other is one cluster.
+    static bool clustered(const Cell &c, double cellSize)
+    {
+        return c.count > 1 && c.extent.width() <= cellSize && c.extent.height() <= cellSize;
+    }
+
+    static void clusters(const shared_ptr<const Cell> &c, const MapBox &box, double cellSize,
+                         vector<int> &points, vector<Cluster> &groups)
+    {
+        if (!c || !c->extent.intersects(box))
+            return;
+        if (clustered(*c, cellSize))
+        {
+            groups.push_back({c->count, c->sumX / c->count, c->sumY / c->count, c->extent});
+            return;
+        }
+        for (const Point &p : c->points)
+            if (box.contains(p.x, p.y))
+                points.push_back(p.id);
+        for (const auto &ch : c->child)
+            clusters(ch, box, cellSize, points, groups);
+    }
+
+public:
+    // Bulk load. The root square is twice the size of the points' bounding
+    // box, so cities can be dragged around without rebuilding the tree.
+    // Time complexity O(V log V)
+    void build(const vector<int> &ids, const vector<pair<double, double>> &coords)
+    {
+        MapBox box;
+        for (const auto &c : coords)
+            box.add(c.first, c.second);
+        root = nullptr;
+        area = MapBox();
+        if (box.empty())
+            return;
+        double side = max(max(box.width(), box.height()) * 2, 1.0);
+        double cx = (box.minX + box.maxX) / 2, cy = (box.minY + box.maxY) / 2;
+        area = {cx - side / 2, cy - side / 2, cx + side / 2, cy + side / 2};
+        for (size_t i = 0; i < ids.size(); i++)
+            root = insert(root, area, {ids[i], coords[i].first, coords[i].second}, 0);
+    }
+
+    int size() const { return root ? root->count : 0; }
+    // Bounding box of all points, empty if there are none.
+    MapBox bounds() const { return root ? root->extent : MapBox(); }
+
+    // Time complexity O(depth), O(V log V) if the point lies outside the root square
+    void insert(int id, double x, double y)
+    {
+        if (!area.contains(x, y))
+        {
+            vector<Point> all;
+            collect(root, all);
+            all.push_back({id, x, y});
+            vector<int> ids;
+            vector<pair<double, double>> coords;
+            for (const Point &p : all)
+            {
+                ids.push_back(p.id);
+                coords.push_back({p.x, p.y});
+            }
+            build(ids, coords);
+            return;
+        }
+        root = insert(root, area, {id, x, y}, 0);
+    }
+
+    // (x, y) must be the position the point was inserted with.
+    // Time complexity O(depth + CAPACITY)
+    bool erase(int id, double x, double y)
+    {
+        bool found = false;
+        root = erase(root, area, id, x, y, found);
+        return found;
+    }
+
+    void move(int id, double oldX, double oldY, double x, double y)
+    {
+        if (erase(id, oldX, oldY))
+            insert(id, x, y);
+    }
+
+    // Ids of the points inside 'box'.
+    // Time complexity O(depth + cells intersecting the box + result)
+    vector<int> query(const MapBox &box) const
+    {
+        vector<int> out;
+        query(root, box, out);
+        return out;
+    }
+
+    // Points inside 'box', except that every cell whose points span at most
+    // 'cellSize' in both directions comes back as one cluster instead. The
+    // result size is bounded by the box area over cellSize^2, however many
+    // points there are.
+    void clusters(const MapBox &box, double cellSize, vector<int> &points, vector<Cluster> &groups) const
+    {
+        clusters(root, box, cellSize, points, groups);
+    }
+
+    // True if the point at (x, y) is hidden in one of the clusters that
+    // clusters(box, cellSize, ...) returns.
+    // Time complexity O(depth)
+    bool inCluster(const MapBox &box, double cellSize, double x, double y) const
+    {
+        MapBox a = area;
+        for (const Cell *c = root.get(); c; )
+        {
+            if (!c->extent.intersects(box) || !c->extent.contains(x, y))
+                return false;
+            if (clustered(*c, cellSize))
+                return true;
+            if (c->leaf)
+                return false;
+            int q = quadrant(a, x, y);
+            a = subArea(a, q);
+            c = c->child[q].get();
+        }
+        return false;
+    }
+};
+
+#endif
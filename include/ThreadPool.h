@@ -0,0 +1,164 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+using namespace std;
+
+// Fixed set of worker threads for the parallel parts of a shift. Every
+// worker owns a deque of tasks: it takes work from the back of its own deque
+// and, once that is empty, steals from the front of the others, so a few
+// expensive tasks (e.g. trees towards far-away hubs) do not leave the other
+// cores idle. The calling thread works along until its batch is done.
+class WorkStealingPool
+{
+private:
+    struct Worker
+    {
+        mutex lock;
+        deque<function<void()>> tasks;
+    };
+
+    vector<unique_ptr<Worker>> queues; // one per thread, plus one for the caller
+    vector<thread> threads;
+
+    mutex batchLock; // held by the caller of run() for its whole batch
+    mutex stateLock;
+    condition_variable wake; // workers: tasks were queued or the pool stops
+    condition_variable done; // caller: the last task of the batch finished
+    atomic<size_t> queued{0};
+    atomic<size_t> pending{0};
+    bool stop = false;
+
+    // Own deque first (newest task), then the others (oldest task).
+    bool take(size_t self, function<void()> &task)
+    {
+        for (size_t k = 0; k < queues.size(); k++)
+        {
+            Worker &w = *queues[(self + k) % queues.size()];
+            lock_guard<mutex> guard(w.lock);
+            if (w.tasks.empty())
+                continue;
+            if (k == 0)
+            {
+                task = move(w.tasks.back());
+                w.tasks.pop_back();
+            }
+            else
+            {
+                task = move(w.tasks.front());
+                w.tasks.pop_front();
+            }
+            queued--;
+            return true;
+        }
+        return false;
+    }
+
+    void finish(function<void()> &task)
+    {
+        task();
+        task = nullptr;
+        if (--pending == 0)
+        {
+            lock_guard<mutex> guard(stateLock);
+            done.notify_all();
+        }
+    }
+
+    void loop(size_t self)
+    {
+        function<void()> task;
+        while (true)
+        {
+            if (take(self, task))
+            {
+                finish(task);
+                continue;
+            }
+            unique_lock<mutex> guard(stateLock);
+            wake.wait(guard, [&]
+                      { return stop || queued > 0; });
+            if (stop)
+                return;
+        }
+    }
+
+public:
+    // 0 threads = one per hardware thread, minus the caller's.
+    explicit WorkStealingPool(unsigned threadCount = 0)
+    {
+        if (threadCount == 0)
+            threadCount = max(1u, thread::hardware_concurrency()) - 1;
+        for (unsigned i = 0; i <= threadCount; i++)
+            queues.push_back(make_unique<Worker>());
+        for (unsigned i = 1; i <= threadCount; i++)
+            threads.emplace_back(&WorkStealingPool::loop, this, i);
+    }
+
+    ~WorkStealingPool()
+    {
+        {
+            lock_guard<mutex> guard(stateLock);
+            stop = true;
+        }
+        wake.notify_all();
+        for (thread &t : threads)
+            t.join();
+    }
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    size_t threadCount() const { return queues.size(); }
+
+    // Runs task(0) .. task(count - 1) and returns when all have finished.
+    // Tasks are dealt round-robin over the deques; which thread ends up
+    // running one is not fixed, so a task may only write to its own slots.
+    // Callers on other threads wait until the running batch is done: the
+    // queued tasks refer to their caller's 'task' and share 'pending'.
+    // A task must not call run() itself.
+    void run(size_t count, const function<void(size_t)> &task)
+    {
+        if (count == 0)
+            return;
+        lock_guard<mutex> batch(batchLock);
+        pending = count;
+        for (size_t i = 0; i < count; i++)
+        {
+            Worker &w = *queues[i % queues.size()];
+            lock_guard<mutex> guard(w.lock);
+            w.tasks.push_back([&task, i]
+                              { task(i); });
+            queued++;
+        }
+        {
+            // A worker checks 'queued' under stateLock before it sleeps
+            lock_guard<mutex> guard(stateLock);
+        }
+        wake.notify_all();
+
+        function<void()> next;
+        while (pending > 0)
+        {
+            if (take(0, next))
+            {
+                finish(next);
+                continue;
+            }
+            unique_lock<mutex> guard(stateLock);
+            done.wait(guard, [&]
+                      { return pending == 0; });
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef TIME_DEPENDENT_H
+#define TIME_DEPENDENT_H
+
+#include <vector>
+#include <queue>
+#include <limits>
+#include <algorithm>
+
+using namespace std;
+
+// Time-dependent travel costs. The simulation clock counts minutes; a road
+// may carry a daily profile and closure windows on top of its static
+// distance and admin block flag:
+//
+//   profile  - (minute of the day, percent of the distance) points; the cost
+//              at any moment is interpolated linearly between the points
+//              around it, wrapping over midnight. No points = 100%.
+//   closures - [from, to) windows in clock minutes during which the road
+//              cannot be entered; a trip that reaches it then waits for the end.
+//
+// Earliest-arrival Dijkstra is exact as long as leaving later never arrives
+// earlier (FIFO). Waiting out a closure keeps that; a profile keeps it if it
+// never falls faster than the clock runs, i.e. (drop in %) * distance / 100
+// stays below the minutes the drop is spread over.
+
+const int MINUTES_PER_DAY = 24 * 60;
+
+struct TravelSchedule
+{
+    vector<pair<int, int>> profile;              // sorted by minute of the day
+    vector<pair<long long, long long>> closures; // sorted, non-overlapping
+
+    bool empty() const { return profile.empty() && closures.empty(); }
+
+    // Percent of the distance when leaving at 'minute' of the day.
+    double factor(int minute) const
+    {
+        if (profile.empty())
+            return 100.0;
+        if (profile.size() == 1)
+            return profile[0].second;
+        // Last point at or before 'minute' and the one after it, across midnight
+        auto it = upper_bound(profile.begin(), profile.end(), make_pair(minute, numeric_limits<int>::max()));
+        pair<int, int> a = it == profile.begin() ? make_pair(profile.back().first - MINUTES_PER_DAY, profile.back().second) : *(it - 1);
+        pair<int, int> b = it == profile.end() ? make_pair(profile.front().first + MINUTES_PER_DAY, profile.front().second) : *it;
+        if (b.first == a.first)
+            return a.second;
+        return a.second + (double)(b.second - a.second) * (minute - a.first) / (b.first - a.first);
+    }
+
+    // Clock minute at which a trip entering the road at 'depart' leaves it.
+    // Time complexity O(log P + log C)
+    long long arrival(long long depart, int distance) const
+    {
+        long long t = depart;
+        auto it = upper_bound(closures.begin(), closures.end(), make_pair(t, numeric_limits<long long>::max()));
+        if (it != closures.begin() && t < (it - 1)->second)
+            t = (it - 1)->second;
+        int minute = (int)(((t % MINUTES_PER_DAY) + MINUTES_PER_DAY) % MINUTES_PER_DAY);
+        return t + (long long)(distance * factor(minute) / 100.0 + 0.5);
+    }
+
+    // True if the road cannot be entered at 'minute'.
+    bool closedAt(long long minute) const
+    {
+        auto it = upper_bound(closures.begin(), closures.end(), make_pair(minute, numeric_limits<long long>::max()));
+        return it != closures.begin() && minute < (it - 1)->second;
+    }
+
+    // Sorts the profile and closures and merges overlapping windows.
+    void normalize()
+    {
+        sort(profile.begin(), profile.end());
+        sort(closures.begin(), closures.end());
+        vector<pair<long long, long long>> merged;
+        for (const auto &c : closures)
+        {
+            if (c.second <= c.first)
+                continue;
+            if (!merged.empty() && c.first <= merged.back().second)
+                merged.back().second = max(merged.back().second, c.second);
+            else
+                merged.push_back(c);
+        }
+        closures.swap(merged);
+    }
+};
+
+// Schedules of one graph version, attached to the edges they apply to. An
+// edge is addressed as (node, position in the node's edge list), which stays
+// valid for the whole life of a GraphIndex (see CSRAdjacency).
+struct TimeTable
+{
+    vector<TravelSchedule> schedules;
+    vector<vector<pair<int, int>>> byNode; // node -> (edge position, schedule)
+
+    bool empty() const { return schedules.empty(); }
+
+    const TravelSchedule *find(int u, int pos) const
+    {
+        if (u >= (int)byNode.size())
+            return nullptr;
+        for (const auto &p : byNode[u])
+            if (p.first == pos)
+                return &schedules[p.second];
+        return nullptr;
+    }
+
+    // Leaving time of edge 'pos' of u when entering it at 'depart'.
+    long long arrival(int u, int pos, long long depart, int distance) const
+    {
+        const TravelSchedule *s = find(u, pos);
+        return s ? s->arrival(depart, distance) : depart + distance;
+    }
+};
+
+struct TimeDependentScratch
+{
+    vector<long long> arrive;
+    vector<int> parent;
+    vector<int> touched;
+};
+
+// Earliest-arrival Dijkstra from s, leaving at clock minute 'depart'.
+// Returns the arrival time at t (-1 if t cannot be reached) and the nodes of
+// the route in 'path'. Admin-blocked roads are skipped as in the static search.
+// Time complexity O((V + E) log V) plus the schedule lookups
+template <typename Adjacency>
+long long earliestArrival(const Adjacency &g, const TimeTable &tt, int s, int t, long long depart, vector<int> &path)
+{
+    const long long NEVER = numeric_limits<long long>::max();
+    int n = g.nodeCount();
+    path.clear();
+    if (s < 0 || t < 0 || s >= n || t >= n)
+        return -1;
+
+    thread_local TimeDependentScratch sc;
+    if ((int)sc.arrive.size() != n)
+    {
+        sc.arrive.assign(n, NEVER);
+        sc.parent.assign(n, -1);
+        sc.touched.clear();
+    }
+
+    priority_queue<pair<long long, int>, vector<pair<long long, int>>, greater<pair<long long, int>>> pq;
+    sc.arrive[s] = depart;
+    sc.touched.push_back(s);
+    pq.push({depart, s});
+    while (!pq.empty())
+    {
+        long long d = pq.top().first;
+        int u = pq.top().second;
+        pq.pop();
+        if (d > sc.arrive[u])
+            continue;
+        if (u == t)
+            break;
+        for (int e = g.begin(u); e < g.end(u); e++)
+        {
+            if (g.blocked[e])
+                continue;
+            int v = g.target[e];
+            long long a = tt.arrival(u, e - g.begin(u), d, g.weight[e]);
+            if (a < sc.arrive[v])
+            {
+                if (sc.arrive[v] == NEVER)
+                    sc.touched.push_back(v);
+                sc.arrive[v] = a;
+                sc.parent[v] = u;
+                pq.push({a, v});
+            }
+        }
+    }
+
+    long long result = sc.arrive[t] == NEVER ? -1 : sc.arrive[t];
+    if (result != -1)
+    {
+        for (int v = t; v != -1; v = sc.parent[v])
+            path.push_back(v);
+        reverse(path.begin(), path.end());
+    }
+    for (int v : sc.touched)
+    {
+        sc.arrive[v] = NEVER;
+        sc.parent[v] = -1;
+    }
+    sc.touched.clear();
+    return result;
+}
+
+#endif
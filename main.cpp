@@ -24,16 +24,14 @@ int main()
     // --- System Core ---
     FastGo appCore;
     Graph graph(appCore.getCities(), appCore.getRoutes());
+    graph.setRoutingMode(ROUTE_CH); // fast one-off city-to-city routes
+    graph.setSchedules(appCore.getSchedules());
+    graph.setClock(appCore.getClock());
 
-    auto refresh = [&]()
-    {
-        // 1. Refresh logic (reloads from DB)
-        graph.refreshGraph();
-
-        // 2. Sync ensures any in-memory changes are pushed back (safety)
-        graph.syncToHash();
-        appCore.saveCitiesToDB();
-    };
+    // Persist the positions picked for cities that had none. After this every
+    // edit goes through Graph's incremental operations and saves one row.
+    graph.syncToHash();
+    appCore.saveCitiesToDB();
 
     // --- STATIC FILE SERVING ---
     CROW_ROUTE(app, "/")([](const crow::request &, crow::response &res)
@@ -112,10 +110,18 @@ int main()
                 res["history"][i]["time"] = (parts.size() > 1) ? parts[1] : "";
             }
 
-            // Parse Future Route: "CityC,CityD"
-            vector<string> planEntries = split(p.routeStr, ',');
-            for(size_t i=0; i<planEntries.size(); i++) {
-                res["future"][i] = planEntries[i];
+            // Future Route: stored as city ids, names are filled in here.
+            // Rows saved before the Route column still carry "CityC,CityD".
+            if (!p.route.empty()) {
+                shared_ptr<const GraphSnapshot> snapshot = graph.pin();
+                for(size_t i=0; i<p.route.size(); i++) {
+                    res["future"][i] = snapshot->getCityName(p.route[i]);
+                }
+            } else {
+                vector<string> planEntries = split(p.routeStr, ',');
+                for(size_t i=0; i<planEntries.size(); i++) {
+                    res["future"][i] = planEntries[i];
+                }
             }
         } else {
             res["found"] = false;
@@ -175,15 +181,67 @@ int main()
         
         crow::json::wvalue res;
         for(size_t i=0; i<logs.size(); i++) res["logs"][i] = logs[i];
+        res["clock"] = appCore.getClock();
         return crow::response(res); });
 
     // --- MAP & GRAPH UTILS ---
+    // Without parameters: every city and road. With a viewport,
+    // /api/map?bbox=minX,minY,maxX,maxY&zoom=<pixels per map unit>, only the
+    // cities and roads inside it, with close cities merged into clusters
+    // (either parameter may be left out: whole map / no clustering).
     CROW_ROUTE(app, "/api/map")
-    ([&]()
+    ([&](const crow::request &req)
      {
         crow::json::wvalue res;
-        const auto& nodes = graph.getNodes();
-        const auto& adj = graph.getAdjList();
+        // Pinned so nodes and edges come from the same version of the map
+        auto snap = graph.pin();
+        const auto& nodes = snap->getNodes();
+        res["version"] = snap->getVersion();
+
+        const char* bbox = req.url_params.get("bbox");
+        const char* zoom = req.url_params.get("zoom");
+        if (bbox || zoom) {
+            MapBox box = snap->getBounds();
+            if (bbox && sscanf(bbox, "%lf,%lf,%lf,%lf", &box.minX, &box.minY, &box.maxX, &box.maxY) != 4)
+                return crow::response(400);
+            MapView view = snap->getMapView(box, zoom ? atof(zoom) : 0.0);
+            const CSRAdjacency& csr = snap->getCSR();
+            MapBox all = snap->getBounds();
+            res["bounds"]["minX"] = all.minX;
+            res["bounds"]["minY"] = all.minY;
+            res["bounds"]["maxX"] = all.maxX;
+            res["bounds"]["maxY"] = all.maxY;
+            res["nodes"] = crow::json::wvalue::list();
+            res["edges"] = crow::json::wvalue::list();
+            res["clusters"] = crow::json::wvalue::list();
+            for (size_t i = 0; i < view.nodes.size(); i++) {
+                const Node& n = nodes[view.nodes[i]];
+                res["nodes"][i]["id"] = n.id;
+                res["nodes"][i]["name"] = n.name;
+                res["nodes"][i]["x"] = n.x;
+                res["nodes"][i]["y"] = n.y;
+            }
+            for (size_t i = 0; i < view.roads.size(); i++) {
+                int u = view.roads[i].first, e = view.roads[i].second;
+                res["edges"][i]["source"] = nodes[u].id;
+                res["edges"][i]["target"] = nodes[csr.target[e]].id;
+                res["edges"][i]["weight"] = csr.weight[e];
+                res["edges"][i]["blocked"] = (bool)csr.blocked[e];
+            }
+            for (size_t i = 0; i < view.clusters.size(); i++) {
+                const QuadTree::Cluster& c = view.clusters[i];
+                res["clusters"][i]["count"] = c.count;
+                res["clusters"][i]["x"] = c.x;
+                res["clusters"][i]["y"] = c.y;
+                res["clusters"][i]["minX"] = c.extent.minX;
+                res["clusters"][i]["minY"] = c.extent.minY;
+                res["clusters"][i]["maxX"] = c.extent.maxX;
+                res["clusters"][i]["maxY"] = c.extent.maxY;
+            }
+            return crow::response(res);
+        }
+
+        const auto& adj = snap->getAdjList();
         for (size_t i = 0; i < nodes.size(); i++) {
             res["nodes"][i]["id"] = nodes[i].id;
             res["nodes"][i]["name"] = nodes[i].name;
@@ -202,30 +260,128 @@ int main()
                 edgeCount++;
             }
         }
-        return res; });
+        return crow::response(res); });
+
+    // Cities closest to a map point, e.g. the hub for an address:
+    // /api/nearest?x=..&y=..&k=3 (add &from=City to only get cities with a route to it)
+    CROW_ROUTE(app, "/api/nearest")
+    ([&](const crow::request &req)
+     {
+        const char* x = req.url_params.get("x");
+        const char* y = req.url_params.get("y");
+        if(!x || !y) return crow::response(400);
+        const char* k = req.url_params.get("k");
+        int count = k ? max(1, min(50, atoi(k))) : 1;
+
+        const char* from = req.url_params.get("from");
+
+        auto snap = graph.pin();
+        const auto& nodes = snap->getNodes();
+        crow::json::wvalue res = crow::json::wvalue::list();
+        auto hits = snap->nearestCities(atof(x), atof(y), count, from ? from : "");
+        for (size_t i = 0; i < hits.size(); i++) {
+            const Node& n = nodes[hits[i].first];
+            res[i]["id"] = n.id;
+            res[i]["name"] = n.name;
+            res[i]["x"] = n.x;
+            res[i]["y"] = n.y;
+            res[i]["distance"] = hits[i].second;
+        }
+        return crow::response(res); });
+
+    // City-to-city road distance for pricing / ETA, from the hub labels:
+    // /api/distance?source=A&dest=B (add &path=1 for the route)
+    CROW_ROUTE(app, "/api/distance")
+    ([&](const crow::request &req)
+     {
+        const char* source = req.url_params.get("source");
+        const char* dest = req.url_params.get("dest");
+        if(!source || !dest) return crow::response(400);
+
+        crow::json::wvalue res;
+        bool fromLabels = false;
+        if (req.url_params.get("path")) {
+            auto route = graph.getDistancePath(source, dest, &fromLabels);
+            res["distance"] = route.first;
+            res["path"] = crow::json::wvalue::list();
+            for (size_t i = 0; i < route.second.size(); i++)
+                res["path"][i] = route.second[i];
+        } else {
+            res["distance"] = graph.getDistance(source, dest, &fromLabels);
+        }
+        // false while the labels are rebuilt after a road change
+        res["fromLabels"] = fromLabels;
+        return crow::response(res); });
+
+    // Many (source, dest) routes in one request: {"pairs":[{"source":..,"dest":..},..]}
+    // Pairs sharing an endpoint are served by a single shortest-path tree.
+    CROW_ROUTE(app, "/api/route_batch").methods(crow::HTTPMethod::Post)([&](const crow::request &req)
+                                                                        {
+        auto x = crow::json::load(req.body);
+        if (!x || !x.has("pairs") || x["pairs"].t() != crow::json::type::List) return crow::response(400);
+
+        vector<pair<string, string>> pairs;
+        for (const auto& item : x["pairs"]) {
+            if (item.t() != crow::json::type::Object || !item.has("source") || !item.has("dest") ||
+                item["source"].t() != crow::json::type::String || item["dest"].t() != crow::json::type::String)
+                return crow::response(400);
+            pairs.push_back({item["source"].s(), item["dest"].s()});
+        }
+
+        int searches = 0;
+        auto routes = graph.getShortestPaths(pairs, &searches);
+
+        crow::json::wvalue res;
+        res["searches"] = searches;
+        res["routes"] = crow::json::wvalue::list();
+        for (size_t i = 0; i < routes.size(); i++) {
+            res["routes"][i]["source"] = pairs[i].first;
+            res["routes"][i]["dest"] = pairs[i].second;
+            res["routes"][i]["distance"] = routes[i].first;
+            res["routes"][i]["path"] = crow::json::wvalue::list();
+            for (size_t j = 0; j < routes[i].second.size(); j++)
+                res["routes"][i]["path"][j] = routes[i].second[j];
+        }
+        return crow::response(res); });
 
     CROW_ROUTE(app, "/api/add_city").methods(crow::HTTPMethod::Post)([&](const crow::request &req)
                                                                      {
         auto x = crow::json::load(req.body);
-        string msg = appCore.addCity(x["name"].s(), x["password"].s());
-        refresh();
+        string name = x["name"].s();
+        string msg = appCore.addCity(name, x["password"].s());
+        if (msg.find("Success") != string::npos) {
+            Node node = graph.addNode(name, appCore.getCities().getPoint(name));
+            appCore.updateCityPosition(name, node.x, node.y);
+        }
         crow::json::wvalue res; res["message"] = msg;
         return crow::response(res); });
 
     CROW_ROUTE(app, "/api/add_route").methods(crow::HTTPMethod::Post)([&](const crow::request &req)
                                                                       {
         auto x = crow::json::load(req.body);
-        string msg = appCore.addRoute(x["key"].s(), x["distance"].i());
-        refresh();
+        RouteKey key = appCore.routeKeyOf(x["key"].s());
+        int distance = x["distance"].i();
+        string msg = appCore.addRoute(key, distance);
         crow::json::wvalue res; res["message"] = msg;
+        if (msg.find("Success") != string::npos) {
+            // New road or new weight for an existing one, applied as a delta
+            RouteUpdate update = graph.addEdge(key, distance, false);
+            res["rerouted"] = appCore.replanAfterRoadChange(graph, update);
+        }
         return crow::response(res); });
 
     CROW_ROUTE(app, "/api/toggle_block").methods(crow::HTTPMethod::Post)([&](const crow::request &req)
                                                                          {
         auto x = crow::json::load(req.body);
-        string msg = appCore.toggleRouteBlock(x["key"].s(), x["block"].b());
-        refresh(); 
+        RouteKey key = appCore.routeKeyOf(x["key"].s());
+        bool block = x["block"].b();
+        string msg = appCore.toggleRouteBlock(key, block);
         crow::json::wvalue res; res["message"] = msg;
+        if (msg.find("Success") != string::npos) {
+            // Only the cached trees and packages that depend on this road are updated
+            RouteUpdate update = graph.setEdgeBlocked(key, block);
+            res["rerouted"] = appCore.replanAfterRoadChange(graph, update);
+        }
         return crow::response(res); });
 
     CROW_ROUTE(app, "/api/update_node").methods(crow::HTTPMethod::Post)([&](const crow::request &req)
@@ -305,6 +461,112 @@ int main()
         crow::json::wvalue res; res["message"] = msg;
         return crow::response(res); });
 
+    // Rush-hour profile and planned closures of one road:
+    // {"key":"A-B","profile":[{"minute":480,"factor":150},..],"closures":[{"from":600,"to":720},..]}
+    CROW_ROUTE(app, "/api/route_schedule").methods(crow::HTTPMethod::Post)([&](const crow::request &req)
+                                                                           {
+        auto x = crow::json::load(req.body);
+        if (!x || !x.has("key")) return crow::response(400);
+        RouteKey key = appCore.routeKeyOf(x["key"].s());
+
+        TravelSchedule schedule;
+        if (x.has("profile"))
+            for (const auto& point : x["profile"])
+                schedule.profile.push_back({(int)point["minute"].i(), (int)point["factor"].i()});
+        if (x.has("closures"))
+            for (const auto& window : x["closures"])
+                schedule.closures.push_back({window["from"].i(), window["to"].i()});
+
+        string msg = appCore.setRouteSchedule(key, schedule);
+        if (msg.find("Success") != string::npos)
+            graph.setSchedule(key, schedule);
+
+        crow::json::wvalue res;
+        res["message"] = msg;
+        res["clock"] = appCore.getClock();
+        return crow::response(res); });
+
+    // Capacity of a road in packages per shift and direction, 0 = unlimited,
+    // e.g. {"key": "Multan-Lahore", "capacity": 3}
+    CROW_ROUTE(app, "/api/route_capacity").methods(crow::HTTPMethod::Post)([&](const crow::request &req)
+                                                                           {
+        auto x = crow::json::load(req.body);
+        if (!x || !x.has("key") || !x.has("capacity")) return crow::response(400);
+        RouteKey key = appCore.routeKeyOf(x["key"].s());
+        int capacity = x["capacity"].i();
+
+        string msg = appCore.setRouteCapacity(key, capacity);
+        if (msg.find("Success") != string::npos)
+            graph.setCapacity(key, capacity);
+
+        crow::json::wvalue res;
+        res["message"] = msg;
+        return crow::response(res); });
+
+    // Plans every queued package at once under the road capacities (min-cost
+    // flow) and saves the routes: per-road flows and per-package routes
+    CROW_ROUTE(app, "/api/plan_dispatch").methods(crow::HTTPMethod::Post)([&]()
+                                                                          {
+        if(appCore.getRole() != Admin) return crow::response(403);
+        auto snap = graph.pin();
+        vector<int> ids;
+        DispatchPlan plan;
+        string msg = appCore.planDispatch(*snap, ids, plan);
+
+        crow::json::wvalue res;
+        res["message"] = msg;
+        res["cost"] = plan.cost;
+        const auto& nodes = snap->getNodes();
+        const auto& csr = snap->getCSR();
+        const auto& caps = snap->getCapacities().byNode;
+        res["edges"] = crow::json::wvalue::list();
+        int count = 0;
+        for (int u = 0; u < csr.nodeCount(); u++)
+            for (int e = csr.begin(u); e < csr.end(u); e++) {
+                if (e >= (int)plan.flow.size() || plan.flow[e] == 0) continue;
+                int capacity = 0;
+                if (u < (int)caps.size())
+                    for (const auto& c : caps[u])
+                        if (csr.begin(u) + c.first == e) capacity = c.second;
+                res["edges"][count]["from"] = nodes[u].name;
+                res["edges"][count]["to"] = nodes[csr.target[e]].name;
+                res["edges"][count]["flow"] = plan.flow[e];
+                res["edges"][count]["capacity"] = capacity;
+                count++;
+            }
+        res["packages"] = crow::json::wvalue::list();
+        for (size_t i = 0; i < ids.size(); i++) {
+            res["packages"][i]["id"] = ids[i];
+            res["packages"][i]["route"] = crow::json::wvalue::list();
+            for (size_t k = 0; k < plan.routes[i].size(); k++)
+                res["packages"][i]["route"][k] = nodes[plan.routes[i][k]].name;
+        }
+        return crow::response(res); });
+
+    // Alternative routes between two cities with their detour over the best one,
+    // e.g. /api/alternatives?source=Multan&dest=Lahore
+    CROW_ROUTE(app, "/api/alternatives")
+    ([&](const crow::request &req)
+     {
+        if(appCore.getRole() != Admin) return crow::response(403);
+        const char* source = req.url_params.get("source");
+        const char* dest = req.url_params.get("dest");
+        if(!source || !dest) return crow::response(400);
+
+        auto routes = graph.getAlternatives(source, dest);
+        crow::json::wvalue res;
+        res["source"] = source;
+        res["dest"] = dest;
+        res["routes"] = crow::json::wvalue::list();
+        for (size_t i = 0; i < routes.size(); i++) {
+            res["routes"][i]["distance"] = routes[i].first;
+            res["routes"][i]["detour"] = routes[i].first - routes[0].first;
+            res["routes"][i]["path"] = crow::json::wvalue::list();
+            for (size_t j = 0; j < routes[i].second.size(); j++)
+                res["routes"][i]["path"][j] = routes[i].second[j];
+        }
+        return crow::response(res); });
+
     // --- ADMIN STATS ---
     CROW_ROUTE(app, "/api/admin_stats")
     ([&]()
@@ -319,6 +581,8 @@ int main()
         res["delivered"] = stats.delivered;
         res["inTransit"] = stats.inTransit;
         res["failed"] = stats.failed;
+        // Groups of cities that are cut off from each other by blocked roads
+        res["partitions"] = graph.componentCount();
         
         return crow::response(res); });
 
@@ -4,6 +4,7 @@ const API_URL = "http://localhost:8080/api";
 let canvas, ctx;
 let nodes = [];
 let edges = [];
+let clusters = [];
 let userRole = "guest";
 let userCity = "";
 
@@ -11,6 +12,12 @@ let userCity = "";
 let isDragging = false, draggedNode = null;
 let transform = { scale: 1, minX: 0, minY: 0, offsetX: 0, offsetY: 0 };
 
+// Viewport: the map is fetched for the visible box only (/api/map?bbox&zoom).
+// view = null fits the whole map; wheel zoom / panning set it to
+// { scale, minX, minY } (map point at the top-left corner of the canvas).
+let worldBounds = null, view = null;
+let isPanning = false, panStart = null, mapLoadTimer = null;
+
 // TRACKING STATE
 let trackingActive = false;
 let trackData = null;
@@ -25,6 +32,8 @@ window.onload = () => {
     canvas.addEventListener('mousedown', handleMouseDown);
     canvas.addEventListener('mousemove', handleMouseMove);
     canvas.addEventListener('mouseup', handleMouseUp);
+    canvas.addEventListener('wheel', handleWheel, { passive: false });
+    canvas.addEventListener('dblclick', () => { view = null; loadMap(); });
     window.addEventListener('resize', () => { resizeCanvas(); drawMap(); });
     resizeCanvas();
 };
@@ -166,23 +175,71 @@ function closeTracking() {
 // --- MAP ENGINE ---
 
 async function loadMap() {
-    const res = await fetch(`${API_URL}/map`);
+    if (!worldBounds) {
+        // zoom=0 folds the whole map into one cluster; only the bounds are needed
+        const first = await (await fetch(`${API_URL}/map?zoom=0`)).json();
+        worldBounds = first.bounds;
+    }
+    fitMapToScreen();
+    // Only the visible part of the map, with close cities clustered
+    let query = `zoom=${transform.scale}`;
+    if (view) {
+        const b = visibleBox();
+        query += `&bbox=${b.minX},${b.minY},${b.maxX},${b.maxY}`;
+    }
+    const res = await fetch(`${API_URL}/map?${query}`);
     const data = await res.json();
-    nodes = data.nodes || []; edges = data.edges || [];
+    nodes = data.nodes || []; edges = data.edges || []; clusters = data.clusters || [];
+    if (data.bounds) worldBounds = data.bounds;
     fitMapToScreen();
     drawMap();
     if (userRole === 'admin') renderRouteManager();
 }
 
+// Reloads the map once the user stops zooming / panning
+function scheduleMapLoad() {
+    clearTimeout(mapLoadTimer);
+    mapLoadTimer = setTimeout(loadMap, 150);
+}
+
 function fitMapToScreen() {
-    if (nodes.length === 0) return;
-    let minX = Infinity, maxX = -Infinity, minY = Infinity, maxY = -Infinity;
-    nodes.forEach(n => { if (n.x < minX) minX = n.x; if (n.x > maxX) maxX = n.x; if (n.y < minY) minY = n.y; if (n.y > maxY) maxY = n.y; });
-    const padding = 60, mapW = maxX - minX || 1, mapH = maxY - minY || 1;
-    const cw = canvas.width - (padding * 2), ch = canvas.height - (padding * 2);
-    const s = Math.min(cw / mapW, ch / mapH);
-    transform = { scale: s, minX, minY, offsetX: padding + (cw - mapW * s) / 2, offsetY: padding + (ch - mapH * s) / 2 };
-    nodes.forEach(n => { if (n !== draggedNode) { n.displayX = (n.x - minX) * s + transform.offsetX; n.displayY = (n.y - minY) * s + transform.offsetY; } });
+    if (!worldBounds || worldBounds.maxX < worldBounds.minX) return;
+    if (view) {
+        transform = { scale: view.scale, minX: view.minX, minY: view.minY, offsetX: 0, offsetY: 0 };
+    } else {
+        const { minX, minY, maxX, maxY } = worldBounds;
+        const padding = 60, mapW = maxX - minX || 1, mapH = maxY - minY || 1;
+        const cw = canvas.width - (padding * 2), ch = canvas.height - (padding * 2);
+        const s = Math.min(cw / mapW, ch / mapH);
+        transform = { scale: s, minX, minY, offsetX: padding + (cw - mapW * s) / 2, offsetY: padding + (ch - mapH * s) / 2 };
+    }
+    const s = transform.scale;
+    nodes.forEach(n => { if (n !== draggedNode) { n.displayX = (n.x - transform.minX) * s + transform.offsetX; n.displayY = (n.y - transform.minY) * s + transform.offsetY; } });
+    clusters.forEach(c => { c.displayX = (c.x - transform.minX) * s + transform.offsetX; c.displayY = (c.y - transform.minY) * s + transform.offsetY; });
+}
+
+// Map coordinates of the canvas corners
+function visibleBox() {
+    const toMapX = px => (px - transform.offsetX) / transform.scale + transform.minX;
+    const toMapY = py => (py - transform.offsetY) / transform.scale + transform.minY;
+    return { minX: toMapX(0), minY: toMapY(0), maxX: toMapX(canvas.width), maxY: toMapY(canvas.height) };
+}
+
+// Current transform as an explicit view, so it can be zoomed / panned
+function currentView() {
+    return view || { scale: transform.scale, minX: transform.minX - transform.offsetX / transform.scale, minY: transform.minY - transform.offsetY / transform.scale };
+}
+
+function handleWheel(e) {
+    e.preventDefault();
+    const v = currentView();
+    const factor = e.deltaY < 0 ? 1.25 : 0.8;
+    // Keep the map point under the cursor in place
+    const mx = e.offsetX / v.scale + v.minX, my = e.offsetY / v.scale + v.minY;
+    const scale = v.scale * factor;
+    view = { scale, minX: mx - e.offsetX / scale, minY: my - e.offsetY / scale };
+    drawMap();
+    scheduleMapLoad();
 }
 
 function drawMap() {
@@ -328,6 +385,24 @@ function drawMap() {
         }
     }
 
+    // Draw Clusters (groups of cities too close to tell apart at this zoom)
+    clusters.forEach(c => {
+        const radius = 16 + Math.min(20, 4 * Math.log2(c.count));
+        ctx.beginPath();
+        ctx.arc(c.displayX, c.displayY, radius, 0, 2 * Math.PI);
+        ctx.fillStyle = 'rgba(99, 102, 241, 0.75)';
+        ctx.fill();
+        ctx.strokeStyle = 'white';
+        ctx.lineWidth = 3;
+        ctx.stroke();
+
+        ctx.font = "bold 13px Inter";
+        ctx.fillStyle = "white";
+        ctx.textAlign = "center";
+        ctx.textBaseline = "middle";
+        ctx.fillText(c.count, c.displayX, c.displayY);
+    });
+
     // Draw Nodes with Enhanced Styling
     let currentVisCity = null;
     if (trackingActive && historyStack.length > 0) {
@@ -516,6 +591,8 @@ async function loadAdminStats() {
     document.getElementById('stat-delivered').innerText = stats.delivered;
     document.getElementById('stat-transit').innerText = stats.inTransit;
     document.getElementById('stat-failed').innerText = stats.failed;
+    // More than one network means some cities are cut off by blocked roads
+    document.getElementById('stat-partitions').innerText = stats.partitions;
 }
 
 // --- ACTIONS & HELPERS ---
@@ -585,7 +662,11 @@ async function nextShift() {
     if (data.logs) alert(data.logs.join('\n'));
 }
 
-function renderRouteManager() {
+async function renderRouteManager() {
+    // The route list shows every road, not just the visible ones
+    const res = await fetch(`${API_URL}/map`);
+    const data = await res.json();
+    const nodes = data.nodes || [], edges = data.edges || [];
     const list = document.getElementById('route-list');
     list.innerHTML = "";
     edges.forEach(e => {
@@ -633,9 +714,32 @@ async function handleMouseDown(e) {
             }
         }
     }
+    if (isDragging) return;
+
+    // Clicking a cluster zooms in on its cities
+    for (let c of clusters) {
+        const dx = mouseX - c.displayX, dy = mouseY - c.displayY;
+        if (dx * dx + dy * dy < 900) {
+            const w = Math.max(c.maxX - c.minX, 1), h = Math.max(c.maxY - c.minY, 1);
+            const scale = Math.min(canvas.width / (w * 2), canvas.height / (h * 2));
+            view = { scale, minX: c.x - canvas.width / (2 * scale), minY: c.y - canvas.height / (2 * scale) };
+            loadMap();
+            return;
+        }
+    }
+
+    // Anywhere else the map is panned
+    isPanning = true;
+    panStart = { x: mouseX, y: mouseY, view: currentView() };
 }
 
 function handleMouseMove(e) {
+    if (isPanning) {
+        const v = panStart.view;
+        view = { scale: v.scale, minX: v.minX - (e.offsetX - panStart.x) / v.scale, minY: v.minY - (e.offsetY - panStart.y) / v.scale };
+        drawMap();
+        return;
+    }
     if (!isDragging || !draggedNode || userRole !== 'admin') return;
     draggedNode.displayX = e.offsetX;
     draggedNode.displayY = e.offsetY;
@@ -645,6 +749,11 @@ function handleMouseMove(e) {
 }
 
 function handleMouseUp() {
+    if (isPanning) {
+        isPanning = false;
+        scheduleMapLoad();
+        return;
+    }
     if (isDragging && draggedNode && userRole === 'admin') {
         fetch(`${API_URL}/update_node`, {
             method: 'POST', body: JSON.stringify(
@@ -0,0 +1,197 @@
+#ifndef TEST_SUPPORT_H
+#define TEST_SUPPORT_H
+
+// Shared pieces of the behaviour tests: a failure counter, small random road
+// networks and the plain Dijkstra every routing path is checked against.
+
+#include "../include/CustomGraph.h"
+#include <random>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+// Failed checks are counted and the first few printed.
+int failures = 0;
+
+#define CHECK(cond, what)                                                                      \
+    do                                                                                         \
+    {                                                                                          \
+        if (!(cond))                                                                           \
+        {                                                                                      \
+            if (failures < 20)                                                                 \
+                cerr << __FILE__ << ":" << __LINE__ << ": " << #cond << " - " << what << "\n"; \
+            failures++;                                                                        \
+        }                                                                                      \
+    } while (0)
+
+// Runs one test and prints how it went.
+template <typename F>
+void runTest(const string &name, F test)
+{
+    int before = failures;
+    test();
+    cout << (failures == before ? "ok     " : "FAILED ") << name;
+    if (failures != before)
+        cout << " (" << failures - before << " checks)";
+    cout << "\n";
+}
+
+struct TestRoad
+{
+    int a, b; // node indices, a != b
+    int weight;
+    bool blocked;
+};
+
+// Undirected network with dense node indices 0 .. n-1; city i is named "C<i>"
+// and has id i + 1, so its roads are keyed by makeRouteKey(a + 1, b + 1).
+struct TestNetwork
+{
+    int n = 0;
+    vector<pair<float, float>> coords;
+    vector<TestRoad> roads;
+
+    static string name(int v) { return "C" + to_string(v); }
+    RouteKey key(int r) const { return makeRouteKey(roads[r].a + 1, roads[r].b + 1); }
+
+    // Index of the road between a and b, -1 if there is none.
+    int find(int a, int b) const
+    {
+        for (int r = 0; r < (int)roads.size(); r++)
+            if ((roads[r].a == a && roads[r].b == b) || (roads[r].a == b && roads[r].b == a))
+                return r;
+        return -1;
+    }
+
+    vector<City> cities() const
+    {
+        vector<City> out;
+        for (int v = 0; v < n; v++)
+            out.push_back({name(v), v + 1, "", coords[v].first, coords[v].second});
+        return out;
+    }
+
+    vector<RouteEntry> routes() const
+    {
+        vector<RouteEntry> out;
+        for (int r = 0; r < (int)roads.size(); r++)
+            out.push_back({key(r), roads[r].weight, roads[r].blocked, OCCUPIED});
+        return out;
+    }
+
+    // Both directions of every road, grouped by source.
+    CSRAdjacency csr() const
+    {
+        CSRAdjacency g;
+        vector<vector<TestRoad>> out(n);
+        for (const TestRoad &r : roads)
+        {
+            out[r.a].push_back(r);
+            out[r.b].push_back({r.b, r.a, r.weight, r.blocked});
+        }
+        for (int u = 0; u < n; u++)
+        {
+            g.offset.push_back(g.target.size());
+            for (const TestRoad &r : out[u])
+            {
+                g.target.push_back(r.b);
+                g.weight.push_back(r.weight);
+                g.blocked.push_back(r.blocked);
+                g.maxWeight = max(g.maxWeight, r.weight);
+            }
+            g.finish.push_back(g.target.size());
+        }
+        g.limit = g.finish;
+        g.arcCount = g.target.size();
+        return g;
+    }
+};
+
+// n cities on a 100 x 100 map (coordinates from 1, 0 means "no position")
+// and up to m roads between random pairs, about as long as the straight line
+// times 1 to 2 so that A* has something to work with. 'blocked' is the share
+// of blocked roads. Sparse enough that some cities end up cut off.
+TestNetwork randomNetwork(int n, int m, double blocked, mt19937 &rng)
+{
+    TestNetwork net;
+    net.n = n;
+    uniform_real_distribution<float> coord(1, 100);
+    uniform_real_distribution<double> unit(0, 1);
+    for (int v = 0; v < n; v++)
+        net.coords.push_back({coord(rng), coord(rng)});
+    for (int tries = 0; (int)net.roads.size() < m && tries < 20 * m; tries++)
+    {
+        int a = rng() % n, b = rng() % n;
+        if (a == b || net.find(a, b) != -1)
+            continue;
+        double length = hypot(net.coords[a].first - net.coords[b].first, net.coords[a].second - net.coords[b].second);
+        int weight = max(1, (int)lround(length * (1 + unit(rng))));
+        net.roads.push_back({a, b, weight, unit(rng) < blocked});
+    }
+    return net;
+}
+
+// Plain Dijkstra over the open roads; -1 for unreachable cities.
+vector<long long> referenceDistances(const TestNetwork &net, int s)
+{
+    vector<vector<pair<int, int>>> out(net.n);
+    for (const TestRoad &r : net.roads)
+        if (!r.blocked)
+        {
+            out[r.a].push_back({r.b, r.weight});
+            out[r.b].push_back({r.a, r.weight});
+        }
+    vector<long long> dist(net.n, -1);
+    priority_queue<pair<long long, int>, vector<pair<long long, int>>, greater<pair<long long, int>>> pq;
+    dist[s] = 0;
+    pq.push({0, s});
+    while (!pq.empty())
+    {
+        long long d = pq.top().first;
+        int u = pq.top().second;
+        pq.pop();
+        if (d > dist[u])
+            continue;
+        for (const auto &e : out[u])
+            if (dist[e.first] == -1 || d + e.second < dist[e.first])
+            {
+                dist[e.first] = d + e.second;
+                pq.push({dist[e.first], e.first});
+            }
+    }
+    return dist;
+}
+
+// Length of a route over open roads from s to t, -1 if it is not one.
+long long routeLength(const TestNetwork &net, const vector<int> &path, int s, int t)
+{
+    if (path.empty() || path.front() != s || path.back() != t)
+        return -1;
+    long long length = 0;
+    for (size_t i = 0; i + 1 < path.size(); i++)
+    {
+        int r = net.find(path[i], path[i + 1]);
+        if (r == -1 || net.roads[r].blocked)
+            return -1;
+        length += net.roads[r].weight;
+    }
+    return length;
+}
+
+vector<int> indicesOf(const vector<string> &names)
+{
+    vector<int> path;
+    for (const string &city : names)
+        path.push_back(stoi(city.substr(1)));
+    return path;
+}
+
+string describe(int s, int t)
+{
+    ostringstream out;
+    out << s << " -> " << t;
+    return out.str();
+}
+
+#endif
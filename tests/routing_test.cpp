@@ -0,0 +1,777 @@
+// Routing behaviour tests on small random networks.
+//
+// Every search the graph offers is compared against a plain Dijkstra or a
+// brute-force enumeration:
+//   trees        - routes and next hops from the cached destination trees
+//   repair       - cached trees repaired after roads are blocked, reopened,
+//                  made longer or shorter, or added
+//   hierarchy    - contraction hierarchy queries, also after road changes
+//                  re-customize it
+//   landmarks    - A* and ALT queries, also after road changes (the
+//                  landmark bounds must stay admissible)
+//   queues       - the searches above with every priority queue
+//   batch        - routes of a batch of pairs sharing trees by endpoint
+//   new roads    - hierarchy queries while new roads wait for the rebuild
+//   alternatives - Yen's k shortest loopless routes against all simple
+//                  paths, and hot pairs served from them across road changes
+//                  (one request computes a pair that gets hot)
+//   schedules    - earliest-arrival routes over profiles and closures
+//                  against a minute-by-minute search that may wait anywhere
+//   labels       - hub label distances and routes
+//   flow         - min-cost flow against Bellman-Ford successive shortest
+//                  paths, and capacity-aware dispatch plans
+//
+// Build and run: make test (exits with 1 if any check failed)
+
+#include "TestSupport.h"
+#include <chrono>
+#include <thread>
+
+using namespace std;
+
+// Every route of 'graph' between all pairs in 'mode' against the reference.
+void checkAllPairs(const Graph &graph, const TestNetwork &net, RoutingMode mode, const string &what)
+{
+    for (int s = 0; s < net.n; s++)
+    {
+        vector<long long> dist = referenceDistances(net, s);
+        for (int t = 0; t < net.n; t++)
+        {
+            pair<int, vector<int>> res = graph.findPath(s, t, mode);
+            CHECK(res.first == dist[t], what << " " << describe(s, t) << ": " << res.first << " instead of " << dist[t]);
+            if (res.first != -1)
+                CHECK(routeLength(net, res.second, s, t) == res.first, what << " " << describe(s, t) << ": route does not add up");
+        }
+    }
+}
+
+// The hop by hop route a shift follows from s to t.
+void checkNextHops(const Graph &graph, const TestNetwork &net, int s, int t, const string &what)
+{
+    long long expected = referenceDistances(net, s)[t];
+    if (expected <= 0)
+        return;
+    vector<int> path = {s};
+    string at = TestNetwork::name(s);
+    while (path.back() != t && (int)path.size() <= net.n)
+    {
+        at = graph.getNextHop(at, TestNetwork::name(t));
+        if (at.empty())
+            break;
+        path.push_back(stoi(at.substr(1)));
+    }
+    CHECK(routeLength(net, path, s, t) == expected, what << " next hops " << describe(s, t));
+}
+
+void testTrees()
+{
+    mt19937 rng(1);
+    for (int round = 0; round < 6; round++)
+    {
+        TestNetwork net = randomNetwork(40, 70, 0.15, rng);
+        SimpleHash noCities(1);
+        hashroutes noRoutes;
+        Graph graph(noCities, noRoutes);
+        graph.load(net.cities(), net.routes());
+        checkAllPairs(graph, net, ROUTE_TREE, "tree");
+        for (int s = 0; s < net.n; s++)
+            for (int t = 0; t < net.n; t += 5)
+                checkNextHops(graph, net, s, t, "tree");
+
+        // By name, through the route cache
+        for (int i = 0; i < 200; i++)
+        {
+            int s = rng() % net.n, t = rng() % 4;
+            pair<int, vector<string>> res = graph.getShortestPath(TestNetwork::name(s), TestNetwork::name(t));
+            long long expected = referenceDistances(net, s)[t];
+            CHECK(res.first == expected, "by name " << describe(s, t));
+            if (res.first != -1)
+                CHECK(routeLength(net, indicesOf(res.second), s, t) == res.first, "by name " << describe(s, t));
+        }
+    }
+}
+
+// One random road change applied to both the graph and the reference:
+// block, reopen, lengthen, shorten or add a road.
+RouteUpdate randomChange(Graph &graph, TestNetwork &net, mt19937 &rng)
+{
+    int kind = rng() % 5;
+    if (kind == 4)
+    {
+        int a = rng() % net.n, b = rng() % net.n;
+        if (a != b && net.find(a, b) == -1)
+        {
+            int weight = 1 + rng() % 60;
+            net.roads.push_back({a, b, weight, false});
+            return graph.addEdge(net.key(net.roads.size() - 1), weight);
+        }
+        kind = rng() % 4;
+    }
+    int r = rng() % net.roads.size();
+    TestRoad &road = net.roads[r];
+    if (kind == 0)
+        road.blocked = true;
+    else if (kind == 1)
+        road.blocked = false;
+    else if (kind == 2)
+        road.weight += 1 + rng() % 40;
+    else
+        road.weight = max(1, road.weight - 1 - (int)(rng() % 40));
+    return graph.updateRoute(net.key(r), road.weight, road.blocked);
+}
+
+// Random changes with trees towards every city cached, checked in 'mode'
+// after each one. Returns how many changes repaired cached trees.
+int checkChanges(RoutingMode mode, mt19937 &rng, const string &what)
+{
+    int repaired = 0;
+    for (int round = 0; round < 4; round++)
+    {
+        TestNetwork net = randomNetwork(30, 55, 0.1, rng);
+        SimpleHash noCities(1);
+        hashroutes noRoutes;
+        Graph graph(noCities, noRoutes);
+        graph.load(net.cities(), net.routes());
+        graph.setRoutingMode(mode);
+        for (int t = 0; t < net.n; t++)
+            graph.findPath(0, t, ROUTE_TREE);
+        for (int step = 0; step < 40; step++)
+        {
+            RouteUpdate update = randomChange(graph, net, rng);
+            if (!update.cachedDestinations.empty())
+                repaired++;
+            string at = what + ", step " + to_string(step);
+            checkAllPairs(graph, net, ROUTE_TREE, at);
+            if (mode != ROUTE_TREE)
+                checkAllPairs(graph, net, mode, at);
+            checkNextHops(graph, net, rng() % net.n, rng() % net.n, at);
+        }
+    }
+    return repaired;
+}
+
+void testRepair()
+{
+    mt19937 rng(2);
+    CHECK(checkChanges(ROUTE_TREE, rng, "repaired tree") > 0, "no change went through the tree repair");
+}
+
+void testHierarchy()
+{
+    mt19937 rng(3);
+    for (int round = 0; round < 6; round++)
+    {
+        TestNetwork net = randomNetwork(40, 70, 0.15, rng);
+        SimpleHash noCities(1);
+        hashroutes noRoutes;
+        Graph graph(noCities, noRoutes);
+        graph.load(net.cities(), net.routes());
+        graph.setRoutingMode(ROUTE_CH);
+        checkAllPairs(graph, net, ROUTE_CH, "ch");
+    }
+    checkChanges(ROUTE_CH, rng, "customized ch");
+}
+
+void testLandmarks()
+{
+    mt19937 rng(4);
+    for (int round = 0; round < 6; round++)
+    {
+        TestNetwork net = randomNetwork(40, 70, 0.15, rng);
+        SimpleHash noCities(1);
+        hashroutes noRoutes;
+        Graph graph(noCities, noRoutes);
+        graph.load(net.cities(), net.routes());
+        checkAllPairs(graph, net, ROUTE_ASTAR, "astar");
+        checkAllPairs(graph, net, ROUTE_ALT, "alt");
+    }
+    checkChanges(ROUTE_ALT, rng, "alt");
+}
+
+void testQueues()
+{
+    const RoutingMode modes[] = {ROUTE_TREE, ROUTE_DIJKSTRA, ROUTE_ASTAR, ROUTE_ALT};
+    const char *modeNames[] = {"tree", "dijkstra", "astar", "alt"};
+    const QueueKind queues[] = {QUEUE_AUTO, QUEUE_BINARY, QUEUE_RADIX, QUEUE_DIAL};
+    mt19937 rng(5);
+    for (int round = 0; round < 4; round++)
+    {
+        TestNetwork net = randomNetwork(40, 70, 0.15, rng);
+        // Short roads too, so QUEUE_AUTO picks the Dial queue on some networks
+        if (round % 2)
+            for (TestRoad &r : net.roads)
+                r.weight = 1 + r.weight % 8;
+        SimpleHash noCities(1);
+        hashroutes noRoutes;
+        Graph graph(noCities, noRoutes);
+        graph.load(net.cities(), net.routes());
+        for (QueueKind queue : queues)
+        {
+            graph.setQueueKind(queue);
+            for (int m = 0; m < 4; m++)
+            {
+                // A new version per queue, so the trees are built with it
+                graph.setRoutingMode(modes[m]);
+                graph.invalidateRoutes();
+                checkAllPairs(graph, net, modes[m], string(modeNames[m]) + " queue " + to_string(queue));
+            }
+        }
+    }
+}
+
+void testBatch()
+{
+    mt19937 rng(7);
+    for (int round = 0; round < 6; round++)
+    {
+        TestNetwork net = randomNetwork(40, 70, 0.15, rng);
+        SimpleHash noCities(1);
+        hashroutes noRoutes;
+        Graph graph(noCities, noRoutes);
+        graph.load(net.cities(), net.routes());
+        // A few hubs on either side, so trees get rooted at sources and destinations
+        vector<pair<string, string>> pairs;
+        for (int i = 0; i < 120; i++)
+        {
+            int hub = rng() % 3, other = rng() % net.n;
+            if (i % 2)
+                pairs.push_back({TestNetwork::name(hub), TestNetwork::name(other)});
+            else
+                pairs.push_back({TestNetwork::name(other), TestNetwork::name(hub)});
+        }
+        pairs.push_back({"C0", "Nowhere"});
+        int searches = 0;
+        vector<pair<int, vector<string>>> routes = graph.getShortestPaths(pairs, &searches);
+        CHECK(routes.size() == pairs.size(), "one answer per pair");
+        CHECK(searches <= 2 * 3 + 1, searches << " searches for 3 hubs");
+        CHECK(routes.back().first == -1, "route to an unknown city");
+        for (size_t i = 0; i + 1 < pairs.size(); i++)
+        {
+            int s = stoi(pairs[i].first.substr(1)), t = stoi(pairs[i].second.substr(1));
+            long long expected = referenceDistances(net, s)[t];
+            CHECK(routes[i].first == expected, "batch " << describe(s, t) << ": " << routes[i].first << " instead of " << expected);
+            if (routes[i].first != -1)
+                CHECK(routeLength(net, indicesOf(routes[i].second), s, t) == routes[i].first, "batch " << describe(s, t) << " does not add up");
+        }
+    }
+}
+
+void testNewRoads()
+{
+    mt19937 rng(9);
+    TestNetwork net = randomNetwork(300, 500, 0.05, rng);
+    SimpleHash noCities(1);
+    hashroutes noRoutes;
+    Graph graph(noCities, noRoutes);
+    graph.load(net.cities(), net.routes());
+    graph.setRoutingMode(ROUTE_CH);
+    int added = 0;
+    for (int i = 0; i < 20; i++)
+    {
+        int a = rng() % net.n, b = rng() % net.n;
+        if (a == b || net.find(a, b) != -1)
+            continue;
+        int weight = 1 + rng() % 60;
+        net.roads.push_back({a, b, weight, false});
+        graph.addEdge(net.key(net.roads.size() - 1), weight);
+        added++;
+        // Answered from the trees or the rebuilt hierarchy, whichever is current
+        for (int q = 0; q < 50; q++)
+        {
+            int s = rng() % net.n, t = rng() % net.n;
+            CHECK(graph.findPath(s, t, ROUTE_CH).first == referenceDistances(net, s)[t], "after new road " << i << " " << describe(s, t));
+        }
+    }
+    CHECK(added > 0, "no road was added");
+    bool rebuilt = false;
+    for (int wait = 0; wait < 500 && !rebuilt; wait++)
+    {
+        rebuilt = graph.pin()->hasHierarchy();
+        if (!rebuilt)
+            this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    CHECK(rebuilt, "the hierarchy was never rebuilt");
+    checkAllPairs(graph, net, ROUTE_CH, "rebuilt ch");
+}
+
+// All simple route lengths from s to t over open roads, sorted.
+void simpleRoutes(const TestNetwork &net, int u, int t, long long length, vector<char> &onPath, vector<long long> &out)
+{
+    if (u == t)
+    {
+        out.push_back(length);
+        return;
+    }
+    onPath[u] = 1;
+    for (const TestRoad &r : net.roads)
+    {
+        if (r.blocked || (r.a != u && r.b != u))
+            continue;
+        int v = r.a == u ? r.b : r.a;
+        if (!onPath[v])
+            simpleRoutes(net, v, t, length + r.weight, onPath, out);
+    }
+    onPath[u] = 0;
+}
+
+void testAlternatives()
+{
+    mt19937 rng(12);
+    const int K = 4;
+    for (int round = 0; round < 40; round++)
+    {
+        TestNetwork net = randomNetwork(8, 14, 0.1, rng);
+        CSRAdjacency csr = net.csr();
+        for (int s = 0; s < net.n; s++)
+            for (int t = 0; t < net.n; t++)
+            {
+                if (s == t)
+                    continue;
+                vector<long long> all;
+                vector<char> onPath(net.n, 0);
+                simpleRoutes(net, s, t, 0, onPath, all);
+                sort(all.begin(), all.end());
+                vector<pair<int, vector<int>>> routes = kShortestPaths(csr, s, t, K);
+                CHECK(routes.size() == min(all.size(), (size_t)K), "yen " << describe(s, t) << ": " << routes.size() << " routes of " << all.size());
+                for (size_t i = 0; i < routes.size() && i < all.size(); i++)
+                {
+                    CHECK(routes[i].first == all[i], "yen " << describe(s, t) << " route " << i << ": " << routes[i].first << " instead of " << all[i]);
+                    CHECK(routeLength(net, routes[i].second, s, t) == routes[i].first, "yen " << describe(s, t) << " route " << i << " does not add up");
+                    vector<int> seen = routes[i].second;
+                    sort(seen.begin(), seen.end());
+                    CHECK(adjacent_find(seen.begin(), seen.end()) == seen.end(), "yen " << describe(s, t) << " route " << i << " has a loop");
+                    for (size_t j = 0; j < i; j++)
+                        CHECK(routes[j].second != routes[i].second, "yen " << describe(s, t) << " repeats a route");
+                }
+            }
+    }
+}
+
+// Hot pairs through the graph: getAlternatives, then routes served from the
+// stored alternatives, also after a road on them is blocked.
+void testHotPairs()
+{
+    mt19937 rng(13);
+    for (int round = 0; round < 20; round++)
+    {
+        TestNetwork net = randomNetwork(10, 20, 0.1, rng);
+        SimpleHash noCities(1);
+        hashroutes noRoutes;
+        Graph graph(noCities, noRoutes);
+        graph.load(net.cities(), net.routes());
+        for (int step = 0; step < 10; step++)
+        {
+            int s = rng() % net.n, t = rng() % net.n;
+            if (s == t)
+                continue;
+            vector<long long> all;
+            vector<char> onPath(net.n, 0);
+            simpleRoutes(net, s, t, 0, onPath, all);
+            sort(all.begin(), all.end());
+            vector<pair<int, vector<string>>> routes = graph.getAlternatives(TestNetwork::name(s), TestNetwork::name(t));
+            // A closure may leave fewer stored routes: the cheapest ones that remain
+            CHECK(routes.size() <= min(all.size(), (size_t)4) && routes.empty() == all.empty(), "alternatives " << describe(s, t) << ": " << routes.size() << " of " << all.size());
+            for (size_t i = 0; i < routes.size() && i < all.size(); i++)
+                CHECK(routes[i].first == all[i] && routeLength(net, indicesOf(routes[i].second), s, t) == all[i], "alternative " << i << " " << describe(s, t));
+
+            for (int use = 0; use < 5; use++)
+            {
+                pair<int, vector<string>> res = graph.getShortestPath(TestNetwork::name(s), TestNetwork::name(t));
+                long long expected = referenceDistances(net, s)[t];
+                CHECK(res.first == expected, "hot pair " << describe(s, t) << " use " << use << ": " << res.first << " instead of " << expected);
+                if (res.first != -1)
+                    CHECK(routeLength(net, indicesOf(res.second), s, t) == res.first, "hot pair " << describe(s, t) << " does not add up");
+            }
+            randomChange(graph, net, rng);
+        }
+    }
+
+    // Requests racing on a pair that gets hot: exactly one computes its routes
+    AlternativeCache cache;
+    atomic<int> claims(0);
+    vector<thread> readers;
+    for (int i = 0; i < 8; i++)
+        readers.emplace_back([&]
+                             {
+            for (int use = 0; use < 100; use++)
+                if (cache.countUse(1, 2, 50))
+                    claims++; });
+    for (thread &reader : readers)
+        reader.join();
+    CHECK(claims == 1, claims << " requests computed the hot pair");
+    cache.store(1, 2, {{7, {1, 2}}});
+    pair<int, vector<int>> best;
+    CHECK(cache.best(1, 2, best) && best.first == 7 && !cache.countUse(1, 2, 50), "stored hot pair");
+}
+
+// Earliest arrival at every city leaving s at 'depart', minute by minute:
+// from every city reached by minute m, every open road may be entered at m.
+// Waiting is allowed anywhere, so this is exact even without FIFO.
+vector<long long> referenceArrivals(const TestNetwork &net, const map<RouteKey, TravelSchedule> &schedules, int s, long long depart, long long horizon)
+{
+    vector<long long> arrive(net.n, -1);
+    arrive[s] = depart;
+    for (long long m = depart; m <= horizon; m++)
+        for (int r = 0; r < (int)net.roads.size(); r++)
+        {
+            const TestRoad &road = net.roads[r];
+            if (road.blocked)
+                continue;
+            auto it = schedules.find(net.key(r));
+            long long leave = it == schedules.end() ? m + road.weight : it->second.arrival(m, road.weight);
+            for (int side = 0; side < 2; side++)
+            {
+                int u = side ? road.b : road.a, v = side ? road.a : road.b;
+                if (arrive[u] != -1 && arrive[u] <= m && (arrive[v] == -1 || leave < arrive[v]))
+                    arrive[v] = leave;
+            }
+        }
+    return arrive;
+}
+
+void testSchedules()
+{
+    mt19937 rng(4);
+    for (int round = 0; round < 5; round++)
+    {
+        TestNetwork net = randomNetwork(20, 36, 0.1, rng);
+        for (TestRoad &r : net.roads)
+            r.weight = 1 + r.weight % 40;
+        // Profiles between 50% and 150% with points at least 3 hours apart,
+        // so a later start never arrives earlier (FIFO, see TimeDependent.h)
+        map<RouteKey, TravelSchedule> schedules;
+        for (int r = 0; r < (int)net.roads.size(); r++)
+        {
+            if (rng() % 3 == 0)
+                continue;
+            TravelSchedule schedule;
+            int points = rng() % 4;
+            for (int p = 0; p < points; p++)
+                schedule.profile.push_back({p * 360 + (int)(rng() % 180), 50 + (int)(rng() % 101)});
+            int windows = rng() % 3;
+            for (int w = 0; w < windows; w++)
+            {
+                long long from = rng() % 2000;
+                schedule.closures.push_back({from, from + 1 + rng() % 240});
+            }
+            schedule.normalize();
+            if (!schedule.empty())
+                schedules[net.key(r)] = schedule;
+        }
+
+        SimpleHash noCities(1);
+        hashroutes noRoutes;
+        Graph graph(noCities, noRoutes);
+        graph.load(net.cities(), net.routes());
+        graph.setSchedules(schedules);
+        for (long long clock : {0LL, 333LL, 1000LL, 1430LL})
+        {
+            graph.setClock(clock);
+            for (int s = 0; s < net.n; s += 3)
+            {
+                vector<long long> arrive = referenceArrivals(net, schedules, s, clock, clock + 3000);
+                for (int t = 0; t < net.n; t++)
+                {
+                    pair<int, vector<string>> res = graph.getShortestPath(TestNetwork::name(s), TestNetwork::name(t));
+                    long long expected = arrive[t] == -1 ? -1 : arrive[t] - clock;
+                    CHECK(res.first == expected, "leaving at " << clock << " " << describe(s, t) << ": " << res.first << " instead of " << expected);
+                    if (res.first <= 0)
+                        continue;
+                    // Driving the route without waiting arrives when promised
+                    vector<int> path = indicesOf(res.second);
+                    long long at = clock;
+                    bool open = path.front() == s && path.back() == t;
+                    for (size_t i = 0; open && i + 1 < path.size(); i++)
+                    {
+                        int r = net.find(path[i], path[i + 1]);
+                        open = r != -1 && !net.roads[r].blocked;
+                        if (!open)
+                            break;
+                        auto it = schedules.find(net.key(r));
+                        at = it == schedules.end() ? at + net.roads[r].weight : it->second.arrival(at, net.roads[r].weight);
+                    }
+                    CHECK(open && at - clock == res.first, "leaving at " << clock << " " << describe(s, t) << ": route takes " << at - clock);
+                }
+            }
+        }
+    }
+}
+
+void testLabels()
+{
+    mt19937 rng(5);
+    for (int round = 0; round < 6; round++)
+    {
+        TestNetwork net = randomNetwork(50, 90, 0.1, rng);
+        CSRAdjacency csr = net.csr();
+        ContractionHierarchy ch;
+        ch.build(csr);
+        HubLabels byDegree, byRank;
+        byDegree.build(csr);
+        byRank.build(csr, ch.importanceOrder());
+        for (int s = 0; s < net.n; s++)
+        {
+            vector<long long> dist = referenceDistances(net, s);
+            for (int t = 0; t < net.n; t++)
+            {
+                CHECK(byDegree.distance(s, t) == dist[t], "labels by degree " << describe(s, t));
+                pair<int, vector<int>> res = byRank.path(s, t);
+                CHECK(res.first == dist[t], "labels by rank " << describe(s, t) << ": " << res.first << " instead of " << dist[t]);
+                if (res.first != -1)
+                    CHECK(routeLength(net, res.second, s, t) == res.first, "label route " << describe(s, t) << " does not add up");
+            }
+        }
+    }
+
+    // Through the graph: background build, then a stale index after a change
+    TestNetwork net = randomNetwork(40, 70, 0.1, rng);
+    SimpleHash noCities(1);
+    hashroutes noRoutes;
+    Graph graph(noCities, noRoutes);
+    graph.load(net.cities(), net.routes());
+    bool fromLabels = false;
+    for (int wait = 0; wait < 500 && !fromLabels; wait++)
+    {
+        graph.getDistance(TestNetwork::name(0), TestNetwork::name(1), &fromLabels);
+        if (!fromLabels)
+            this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    CHECK(fromLabels, "the labels were never built");
+    for (int step = 0; step < 2; step++)
+    {
+        for (int s = 0; s < net.n; s++)
+        {
+            vector<long long> dist = referenceDistances(net, s);
+            for (int t = 0; t < net.n; t++)
+            {
+                pair<int, vector<string>> res = graph.getDistancePath(TestNetwork::name(s), TestNetwork::name(t));
+                CHECK(graph.getDistance(TestNetwork::name(s), TestNetwork::name(t)) == dist[t], "getDistance " << describe(s, t) << " step " << step);
+                CHECK(res.first == dist[t], "getDistancePath " << describe(s, t) << " step " << step);
+                if (res.first != -1)
+                    CHECK(routeLength(net, indicesOf(res.second), s, t) == res.first, "getDistancePath " << describe(s, t) << " does not add up");
+            }
+        }
+        randomChange(graph, net, rng);
+    }
+}
+
+struct TestArc
+{
+    int u, v;
+    long long cap, cost;
+};
+
+// Successive shortest paths with Bellman-Ford (no potentials): {flow, cost}.
+pair<long long, long long> referenceFlow(int n, const vector<TestArc> &arcs, int s, int t, long long limit)
+{
+    struct Residual
+    {
+        int to;
+        long long cap, cost;
+    };
+    vector<Residual> res;
+    vector<vector<int>> out(n);
+    for (const TestArc &a : arcs)
+    {
+        out[a.u].push_back(res.size());
+        res.push_back({a.v, a.cap, a.cost});
+        out[a.v].push_back(res.size());
+        res.push_back({a.u, 0, -a.cost});
+    }
+    const long long NONE = numeric_limits<long long>::max();
+    long long flow = 0, cost = 0;
+    while (flow < limit)
+    {
+        vector<long long> dist(n, NONE);
+        vector<int> via(n, -1), from(n, -1);
+        dist[s] = 0;
+        for (int round = 0; round < n; round++)
+            for (int u = 0; u < n; u++)
+                if (dist[u] != NONE)
+                    for (int i : out[u])
+                        if (res[i].cap > 0 && dist[u] + res[i].cost < dist[res[i].to])
+                        {
+                            dist[res[i].to] = dist[u] + res[i].cost;
+                            via[res[i].to] = i;
+                            from[res[i].to] = u;
+                        }
+        if (dist[t] == NONE)
+            break;
+        long long push = limit - flow;
+        for (int v = t; v != s; v = from[v])
+            push = min(push, res[via[v]].cap);
+        for (int v = t; v != s; v = from[v])
+        {
+            res[via[v]].cap -= push;
+            res[via[v] ^ 1].cap += push;
+        }
+        flow += push;
+        cost += push * dist[t];
+    }
+    return {flow, cost};
+}
+
+void testFlow()
+{
+    mt19937 rng(6);
+    for (int round = 0; round < 300; round++)
+    {
+        int n = 3 + rng() % 6;
+        vector<TestArc> arcs;
+        int m = n + rng() % (2 * n);
+        for (int i = 0; i < m; i++)
+        {
+            int u = rng() % n, v = rng() % n;
+            if (u != v)
+                arcs.push_back({u, v, 1 + (long long)(rng() % 4), 1 + (long long)(rng() % 9)});
+        }
+        long long limit = 1 + rng() % 10;
+        MinCostFlow mcf(n);
+        vector<int> pos;
+        for (const TestArc &a : arcs)
+            pos.push_back(mcf.addArc(a.u, a.v, a.cap, a.cost));
+        pair<long long, long long> got = mcf.solve(0, n - 1, limit);
+        pair<long long, long long> expected = referenceFlow(n, arcs, 0, n - 1, limit);
+        CHECK(got == expected, "flow round " << round << ": {" << got.first << ", " << got.second << "} instead of {" << expected.first << ", " << expected.second << "}");
+
+        // Flows within capacity, conserved, and adding up to the cost
+        vector<long long> balance(n, 0);
+        long long cost = 0;
+        for (size_t i = 0; i < arcs.size(); i++)
+        {
+            long long f = mcf.flowOn(arcs[i].u, pos[i]);
+            CHECK(f >= 0 && f <= arcs[i].cap, "flow round " << round << " arc " << i);
+            balance[arcs[i].u] -= f;
+            balance[arcs[i].v] += f;
+            cost += f * arcs[i].cost;
+        }
+        CHECK(cost == got.second, "flow round " << round << ": arc flows cost " << cost);
+        for (int v = 1; v + 1 < n; v++)
+            CHECK(balance[v] == 0, "flow round " << round << " node " << v << " is not balanced");
+        CHECK(balance[n - 1] == got.first, "flow round " << round << " sink");
+
+        // Decomposition into paths of the same total
+        long long paths = 0, total = 0, length;
+        for (vector<int> p = mcf.takePath(0, n - 1, length); !p.empty(); p = mcf.takePath(0, n - 1, length))
+        {
+            paths++;
+            total += length;
+        }
+        CHECK(paths == got.first && total == got.second, "flow round " << round << ": " << paths << " paths costing " << total);
+    }
+
+    // Zero-cost arcs: this flow runs around the cycle 0 -> 3 -> 2 -> 0, and
+    // the paths taken out of it must still be simple
+    vector<TestArc> arcs = {{4, 0, 2, 0}, {3, 4, 1, 0}, {1, 4, 3, 0}, {2, 0, 1, 0}, {0, 4, 1, 0}, {2, 5, 2, 0}, {0, 3, 1, 0}, {5, 2, 3, 1}, {2, 1, 2, 0}, {0, 5, 1, 0}, {4, 1, 3, 1}, {1, 5, 1, 0}, {3, 2, 2, 0}, {0, 3, 1, 1}, {5, 2, 1, 0}, {1, 5, 2, 1}, {5, 2, 1, 0}, {4, 3, 1, 0}};
+    MinCostFlow mcf(6);
+    for (const TestArc &a : arcs)
+        mcf.addArc(a.u, a.v, a.cap, a.cost);
+    pair<long long, long long> got = mcf.solve(0, 5, 10);
+    CHECK(got == referenceFlow(6, arcs, 0, 5, 10), "zero-cost flow: {" << got.first << ", " << got.second << "}");
+    long long paths = 0, total = 0, length;
+    for (vector<int> p = mcf.takePath(0, 5, length); !p.empty(); p = mcf.takePath(0, 5, length))
+    {
+        paths++;
+        total += length;
+        CHECK(set<int>(p.begin(), p.end()).size() == p.size(), "zero-cost flow path " << paths << " visits a city twice");
+    }
+    CHECK(paths == got.first && total == got.second, "zero-cost flow: " << paths << " paths costing " << total);
+}
+
+void testDispatch()
+{
+    mt19937 rng(7);
+    for (int round = 0; round < 20; round++)
+    {
+        TestNetwork net = randomNetwork(20, 45, 0.05, rng);
+        bool capped = round % 2 == 1;
+        map<pair<int, int>, int> capacity; // road (a < b) -> packages per direction
+        for (auto &r : net.roads)
+            if (capped && rng() % 2 == 0)
+                capacity[{min(r.a, r.b), max(r.a, r.b)}] = 1 + rng() % 2;
+        SimpleHash noCities(1);
+        hashroutes noRoutes;
+        Graph graph(noCities, noRoutes);
+        graph.load(net.cities(), net.routes());
+        for (const auto &c : capacity)
+            graph.setCapacity(makeRouteKey(c.first.first + 1, c.first.second + 1), c.second);
+
+        // One destination per batch, so the plan is one min-cost flow
+        int dest = rng() % net.n;
+        vector<pair<string, string>> trips;
+        vector<long long> supply(net.n, 0);
+        vector<long long> toDest = referenceDistances(net, dest);
+        for (int i = 0; i < 12; i++)
+        {
+            int s = rng() % net.n;
+            if (s == dest)
+                continue;
+            trips.push_back({TestNetwork::name(s), TestNetwork::name(dest)});
+            supply[s]++;
+        }
+        DispatchPlan plan = graph.pin()->planDispatch(trips);
+
+        map<pair<int, int>, int> load;
+        long long cost = 0;
+        int planned = 0;
+        for (size_t i = 0; i < trips.size(); i++)
+        {
+            const vector<int> &route = plan.routes[i];
+            if (route.empty())
+                continue;
+            int s = stoi(trips[i].first.substr(1));
+            long long length = routeLength(net, route, s, dest);
+            CHECK(length != -1, "dispatch round " << round << " trip " << i << " is not a route");
+            if (!capped)
+                CHECK(length == toDest[s], "dispatch round " << round << " trip " << i << ": " << length << " instead of " << toDest[s]);
+            for (size_t k = 0; k + 1 < route.size(); k++)
+                load[{route[k], route[k + 1]}]++;
+            cost += length;
+            planned++;
+        }
+        CHECK(cost == plan.cost, "dispatch round " << round << ": routes cost " << cost << ", plan says " << plan.cost);
+        for (const auto &l : load)
+        {
+            auto it = capacity.find({min(l.first.first, l.first.second), max(l.first.first, l.first.second)});
+            if (it != capacity.end())
+                CHECK(l.second <= it->second, "dispatch round " << round << " overloads " << describe(l.first.first, l.first.second));
+        }
+
+        // Reference: super source -> starts -> open roads (both ways) -> dest
+        vector<TestArc> arcs;
+        int source = net.n;
+        for (int v = 0; v < net.n; v++)
+            if (supply[v] > 0)
+                arcs.push_back({source, v, supply[v], 0});
+        for (const TestRoad &r : net.roads)
+        {
+            if (r.blocked)
+                continue;
+            auto it = capacity.find({min(r.a, r.b), max(r.a, r.b)});
+            long long cap = it == capacity.end() ? (long long)trips.size() : it->second;
+            arcs.push_back({r.a, r.b, cap, r.weight});
+            arcs.push_back({r.b, r.a, cap, r.weight});
+        }
+        pair<long long, long long> expected = referenceFlow(net.n + 1, arcs, source, dest, trips.size());
+        CHECK(planned == expected.first && plan.cost == expected.second,
+              "dispatch round " << round << ": " << planned << " trips for " << plan.cost << " instead of " << expected.first << " for " << expected.second);
+    }
+}
+
+int main()
+{
+    runTest("trees", testTrees);
+    runTest("repair", testRepair);
+    runTest("hierarchy", testHierarchy);
+    runTest("landmarks", testLandmarks);
+    runTest("queues", testQueues);
+    runTest("batch", testBatch);
+    runTest("new roads", testNewRoads);
+    runTest("alternatives", testAlternatives);
+    runTest("hot pairs", testHotPairs);
+    runTest("schedules", testSchedules);
+    runTest("labels", testLabels);
+    runTest("flow", testFlow);
+    runTest("dispatch", testDispatch);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,443 @@
+// Behaviour tests of the data structures, against brute force or std::map:
+//   tree cache    - the node budget and least-recently-used eviction
+//   route blobs   - varint encoding of route plans round trip
+//   pool          - WorkStealingPool batches started from several threads
+//   quadtree      - box queries while points are added, removed and moved;
+//                   older versions keep answering as before
+//   kdtree        - k nearest cities, with moved cities left as stale entries
+//   tables        - OpenAddressTable (every probe policy) and ConcurrentTable
+//                   under random inserts and erases
+//   concurrent    - ConcurrentTable with writer threads churning keys and
+//                   growing the table while reader threads look up keys that
+//                   never change
+//
+// Build and run: make test (exits with 1 if any check failed)
+
+#include "TestSupport.h"
+#include "../include/Package.h"
+#include "../include/ThreadPool.h"
+#include <atomic>
+#include <thread>
+
+using namespace std;
+
+shared_ptr<const ShortestPathTree> treeOf(int root, int nodes)
+{
+    auto tree = make_shared<ShortestPathTree>();
+    tree->root = root;
+    tree->dist.assign(nodes, 0);
+    tree->nextHop.assign(nodes, -1);
+    return tree;
+}
+
+vector<int> rootsOf(const TreeCache &cache)
+{
+    vector<int> roots;
+    for (const auto &entry : cache.entries())
+        roots.push_back(entry.first);
+    return roots;
+}
+
+void testTreeCache()
+{
+    TreeCache cache(100);
+    auto first = cache.insert(0, treeOf(0, 30));
+    cache.insert(1, treeOf(1, 30));
+    cache.insert(2, treeOf(2, 30));
+    CHECK(cache.insert(0, treeOf(0, 30)) == first, "the first stored tree wins");
+    cache.find(0);
+    // 120 nodes do not fit: tree 1 was used least recently
+    cache.insert(3, treeOf(3, 30));
+    CHECK(rootsOf(cache) == vector<int>({2, 0, 3}), "entries are not least recent first");
+    CHECK(!cache.find(1), "tree 1 should have been dropped");
+    CHECK(first.use_count() > 1 && cache.find(0) == first, "tree 0 was used recently and stays");
+
+    // A tree over the whole budget still goes in, alone
+    cache.insert(4, treeOf(4, 150));
+    CHECK(rootsOf(cache) == vector<int>({4}), "the large tree should push out the others");
+
+    mt19937 rng(10);
+    TreeCache random(500);
+    for (int op = 0; op < 2000; op++)
+    {
+        int root = rng() % 40;
+        if (rng() % 2)
+            random.find(root);
+        else
+            random.insert(root, treeOf(root, 1 + rng() % 120));
+        size_t total = 0;
+        for (const auto &entry : random.entries())
+            total += entry.second->dist.size();
+        CHECK(total <= 500, "cache holds " << total << " nodes at op " << op);
+    }
+}
+
+void testRouteBlobs()
+{
+    mt19937 rng(13);
+    const int edges[] = {0, 1, 127, 128, 255, 16383, 16384, 2097151, 2097152, numeric_limits<int>::max()};
+    vector<int> route(begin(edges), end(edges));
+    string blob = encodeRoute(route);
+    CHECK(decodeRoute(blob.data(), blob.size()) == route, "round trip of the 7-bit boundaries");
+    CHECK(blob.size() == 1 + 1 + 1 + 2 + 2 + 2 + 3 + 3 + 4 + 5, "encoded size " << blob.size());
+    CHECK(decodeRoute(nullptr, 0).empty(), "empty blob");
+    CHECK(encodeRoute({5, 90, 127}).size() == 3, "small ids take one byte");
+    for (int round = 0; round < 1000; round++)
+    {
+        vector<int> r(rng() % 20);
+        for (int &id : r)
+            id = rng() % 2 ? (int)(rng() % 200) : (int)(rng() & 0x7FFFFFFF);
+        string b = encodeRoute(r);
+        CHECK(decodeRoute(b.data(), b.size()) == r, "round trip " << round);
+    }
+}
+
+void testPool()
+{
+    WorkStealingPool pool(3);
+    const int CALLERS = 4, BATCHES = 50, TASKS = 300;
+    vector<vector<atomic<int>>> runs(CALLERS);
+    for (auto &r : runs)
+        r = vector<atomic<int>>(TASKS);
+    atomic<int> overlap{0};
+    vector<thread> callers;
+    for (int c = 0; c < CALLERS; c++)
+        callers.emplace_back([&, c]()
+                             {
+            for (int b = 0; b < BATCHES; b++)
+            {
+                vector<int> mine(TASKS, 0);
+                pool.run(TASKS, [&](size_t i)
+                         {
+                    mine[i]++;
+                    runs[c][i]++; });
+                for (int i = 0; i < TASKS; i++)
+                    if (mine[i] != 1)
+                        overlap++;
+            } });
+    for (thread &t : callers)
+        t.join();
+    CHECK(overlap == 0, overlap << " tasks did not run exactly once in their batch");
+    for (int c = 0; c < CALLERS; c++)
+        for (int i = 0; i < TASKS; i++)
+            CHECK(runs[c][i] == BATCHES, "caller " << c << " task " << i << " ran " << runs[c][i] << " times");
+}
+
+vector<int> bruteQuery(const map<int, pair<double, double>> &points, const MapBox &box)
+{
+    vector<int> ids;
+    for (const auto &p : points)
+        if (box.contains(p.second.first, p.second.second))
+            ids.push_back(p.first);
+    return ids;
+}
+
+void checkQueries(const QuadTree &tree, const map<int, pair<double, double>> &points, mt19937 &rng, const string &what)
+{
+    CHECK(tree.size() == (int)points.size(), what << ": size " << tree.size() << " instead of " << points.size());
+    uniform_real_distribution<double> coord(-20, 220);
+    for (int q = 0; q < 40; q++)
+    {
+        MapBox box;
+        box.add(coord(rng), coord(rng));
+        box.add(coord(rng), coord(rng));
+        vector<int> got = tree.query(box);
+        sort(got.begin(), got.end());
+        CHECK(got == bruteQuery(points, box), what << ": box query " << q);
+    }
+}
+
+void testQuadTree()
+{
+    mt19937 rng(11);
+    // Integer positions, so some cities share a spot
+    auto spot = [&]()
+    { return (double)(rng() % 100); };
+    map<int, pair<double, double>> points;
+    vector<int> ids;
+    vector<pair<double, double>> coords;
+    for (int id = 0; id < 150; id++)
+    {
+        points[id] = {spot(), spot()};
+        ids.push_back(id);
+        coords.push_back(points[id]);
+    }
+    QuadTree tree;
+    tree.build(ids, coords);
+    checkQueries(tree, points, rng, "built");
+
+    QuadTree before = tree;
+    map<int, pair<double, double>> beforePoints = points;
+    for (int id = 150; id < 400; id++)
+    {
+        // Now and then far outside the root square, which forces a rebuild
+        points[id] = rng() % 25 == 0 ? make_pair(spot() + 150, spot()) : make_pair(spot(), spot());
+        tree.insert(id, points[id].first, points[id].second);
+    }
+    checkQueries(tree, points, rng, "inserted");
+    for (int i = 0; i < 200; i++)
+    {
+        int id = rng() % 400;
+        auto it = points.find(id);
+        if (it == points.end())
+        {
+            CHECK(!tree.erase(id, 1, 1), "erased a missing point");
+            continue;
+        }
+        if (rng() % 2)
+        {
+            CHECK(tree.erase(id, it->second.first, it->second.second), "erase " << id);
+            points.erase(it);
+        }
+        else
+        {
+            pair<double, double> to = {spot(), spot()};
+            tree.move(id, it->second.first, it->second.second, to.first, to.second);
+            it->second = to;
+        }
+    }
+    checkQueries(tree, points, rng, "erased and moved");
+    checkQueries(before, beforePoints, rng, "older version");
+}
+
+void testKdTree()
+{
+    mt19937 rng(12);
+    uniform_real_distribution<float> coord(0, 100);
+    vector<pair<float, float>> at(300);
+    vector<int> ids;
+    for (int id = 0; id < 300; id++)
+    {
+        at[id] = {coord(rng), coord(rng)};
+        if (id < 100)
+            ids.push_back(id);
+    }
+    KdTree tree;
+    tree.build(ids, vector<pair<float, float>>(at.begin(), at.begin() + 100));
+    int count = 100;
+    for (int step = 0; step < 300; step++)
+    {
+        if (count < 300)
+        {
+            tree.insert(count, at[count].first, at[count].second);
+            count++;
+        }
+        else
+        {
+            // A moved city: inserted again, the old entry goes stale
+            int id = rng() % count;
+            at[id] = {coord(rng), coord(rng)};
+            tree.insert(id, at[id].first, at[id].second);
+            tree.markStale();
+        }
+
+        double x = coord(rng), y = coord(rng);
+        int k = 1 + rng() % 6;
+        auto current = [&](int id, float px, float py)
+        { return at[id].first == px && at[id].second == py && id % 7 != 0; };
+        vector<pair<double, int>> got = tree.nearest(x, y, k, current);
+        vector<double> expected;
+        for (int id = 0; id < count; id++)
+            if (id % 7 != 0)
+                expected.push_back((at[id].first - x) * (at[id].first - x) + (at[id].second - y) * (at[id].second - y));
+        sort(expected.begin(), expected.end());
+        expected.resize(min((int)expected.size(), k));
+        CHECK(got.size() == expected.size(), "nearest " << k << " at step " << step << ": " << got.size() << " found");
+        for (size_t i = 0; i < got.size() && i < expected.size(); i++)
+        {
+            const auto &p = at[got[i].second];
+            double d = (p.first - x) * (p.first - x) + (p.second - y) * (p.second - y);
+            CHECK(abs(got[i].first - expected[i]) < 1e-3 && abs(d - got[i].first) < 1e-3, "nearest " << k << " at step " << step << " entry " << i);
+        }
+    }
+}
+
+// Lookup shared by both tables.
+template <class Probe>
+bool get(const OpenAddressTable<uint64_t, uint64_t, IntHash, Probe> &table, uint64_t key, uint64_t &out)
+{
+    const uint64_t *v = table.find(key);
+    if (v)
+        out = *v;
+    return v != nullptr;
+}
+
+template <class Probe>
+bool get(const ConcurrentTable<uint64_t, uint64_t, IntHash, Probe> &table, uint64_t key, uint64_t &out)
+{
+    return table.find(key, out);
+}
+
+// Random inserts, replacements and erases, checked against std::map.
+template <class Table>
+void churnAgainstMap(Table &table, mt19937 &rng, const string &what)
+{
+    map<uint64_t, uint64_t> expected;
+    for (int op = 0; op < 30000; op++)
+    {
+        uint64_t key = rng() % 3000;
+        if (rng() % 3 == 0)
+            CHECK(table.erase(key) == (expected.erase(key) == 1), what << ": erase " << key);
+        else
+        {
+            uint64_t value = rng();
+            CHECK(table.insert(key, value) == (expected.count(key) == 0), what << ": insert " << key);
+            expected[key] = value;
+        }
+        if (op % 5000 == 4999)
+        {
+            CHECK(table.size() == (int)expected.size(), what << ": size");
+            for (uint64_t k = 0; k < 3000; k++)
+            {
+                uint64_t got = 0;
+                auto it = expected.find(k);
+                bool found = get(table, k, got);
+                CHECK(found == (it != expected.end()) && (!found || got == it->second), what << ": find " << k);
+            }
+            int seen = 0;
+            table.forEach([&](const uint64_t &k, const uint64_t &v)
+                          {
+                seen++;
+                auto it = expected.find(k);
+                CHECK(it != expected.end() && it->second == v, what << ": forEach " << k); });
+            CHECK(seen == (int)expected.size(), what << ": forEach saw " << seen);
+        }
+    }
+}
+
+void testTables()
+{
+    mt19937 rng(14);
+    {
+        OpenAddressTable<uint64_t, uint64_t, IntHash, LinearProbe> table(8);
+        churnAgainstMap(table, rng, "open linear");
+    }
+    {
+        OpenAddressTable<uint64_t, uint64_t, IntHash, QuadraticProbe> table(8, 0.9);
+        churnAgainstMap(table, rng, "open quadratic");
+    }
+    {
+        OpenAddressTable<uint64_t, uint64_t, IntHash, RobinHoodProbe> table(8, 0.9);
+        churnAgainstMap(table, rng, "open robin hood");
+    }
+    {
+        ConcurrentTable<uint64_t, uint64_t, IntHash, LinearProbe> table(8);
+        churnAgainstMap(table, rng, "concurrent linear");
+    }
+    {
+        ConcurrentTable<uint64_t, uint64_t, IntHash, QuadraticProbe> table(8, 0.9);
+        churnAgainstMap(table, rng, "concurrent quadratic");
+    }
+
+    // String keys looked up by string_view, as SimpleHash does
+    ConcurrentTable<string, int> names(4);
+    for (int i = 0; i < 500; i++)
+        names.insert("City" + to_string(i), i);
+    for (int i = 0; i < 500; i += 2)
+        names.erase(string_view("City" + to_string(i)));
+    for (int i = 0; i < 500; i++)
+    {
+        int v = -1;
+        bool found = names.find(string_view("City" + to_string(i)), v);
+        CHECK(found == (i % 2 == 1) && (!found || v == i), "string key City" << i);
+    }
+}
+
+void testConcurrentTable()
+{
+    const int READERS = 4, WRITERS = 4, STABLE = 2000, OPS = 40000;
+    // Small start so the writers grow it several times under the readers
+    ConcurrentTable<uint64_t, uint64_t, IntHash> table(16);
+    for (uint64_t k = 0; k < STABLE; k++)
+        table.insert(k, k * 3);
+
+    atomic<bool> stop{false};
+    atomic<int> lost{0}, wrong{0};
+    vector<thread> readers;
+    for (int r = 0; r < READERS; r++)
+        readers.emplace_back([&, r]()
+                             {
+            mt19937 rng(100 + r);
+            while (!stop)
+            {
+                uint64_t k = rng() % STABLE, v = 0;
+                if (!table.find(k, v))
+                    lost++;
+                else if (v != k * 3)
+                    wrong++;
+                // Churned keys may come and go but never carry another value
+                uint64_t c = 1000000 + rng() % (WRITERS * 5000);
+                if (table.find(c, v) && v != c * 7)
+                    wrong++;
+            } });
+
+    vector<set<uint64_t>> owned(WRITERS);
+    vector<thread> writers;
+    for (int w = 0; w < WRITERS; w++)
+        writers.emplace_back([&, w]()
+                             {
+            mt19937 rng(200 + w);
+            for (int op = 0; op < OPS; op++)
+            {
+                uint64_t c = 1000000 + w * 5000 + rng() % 5000;
+                int kind = rng() % 4;
+                if (kind == 0)
+                {
+                    table.erase(c);
+                    owned[w].erase(c);
+                }
+                else if (kind == 1)
+                {
+                    table.upsert(c, [&](uint64_t &v, bool)
+                                 { v = c * 7; });
+                    owned[w].insert(c);
+                }
+                else if (kind == 2)
+                {
+                    // Rewrites a stable key with the value it already has
+                    uint64_t k = rng() % STABLE;
+                    table.update(k, [&](uint64_t &v)
+                                 { v = k * 3; });
+                }
+                else
+                {
+                    table.insert(c, c * 7);
+                    owned[w].insert(c);
+                }
+            } });
+    for (thread &t : writers)
+        t.join();
+    stop = true;
+    for (thread &t : readers)
+        t.join();
+
+    CHECK(lost == 0, lost << " lookups missed a key that was always there");
+    CHECK(wrong == 0, wrong << " lookups returned a wrong value");
+    size_t expected = STABLE;
+    for (int w = 0; w < WRITERS; w++)
+    {
+        expected += owned[w].size();
+        for (uint64_t c : owned[w])
+        {
+            uint64_t v = 0;
+            CHECK(table.find(c, v) && v == c * 7, "writer " << w << " key " << c);
+        }
+    }
+    CHECK(table.size() == (int)expected, "size " << table.size() << " instead of " << expected);
+    int seen = 0;
+    table.forEach([&](const uint64_t &, const uint64_t &)
+                  { seen++; });
+    CHECK(seen == (int)expected, "forEach saw " << seen << " of " << expected);
+}
+
+int main()
+{
+    runTest("tree cache", testTreeCache);
+    runTest("route blobs", testRouteBlobs);
+    runTest("pool", testPool);
+    runTest("quadtree", testQuadTree);
+    runTest("kdtree", testKdTree);
+    runTest("tables", testTables);
+    runTest("concurrent table", testConcurrentTable);
+    return failures == 0 ? 0 : 1;
+}